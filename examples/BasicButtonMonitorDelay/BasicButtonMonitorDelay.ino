@@ -62,8 +62,8 @@
  * Compatibility: Tested with ESP32 DevKitC and DOIT ESP32 DevKit boards.
  */
 
-// Enable debug output for delayed callbacks
-#define DEBUG_DELAYED_CALLBACKS
+// To trace delayed callbacks into the library's RAM trace buffer (printed from loop()),
+// build with -DDEBUG_DELAYED_CALLBACKS in the build flags (see Build Options in the README).
 
 #include "AvantDigitalRead.h"
 
@@ -185,6 +185,9 @@ void loop() {
   // Must call update() regularly to process events
   pinManager.update();
   
+  // Print the trace records collected since the last call (nothing if tracing is off)
+  pinManager.printTrace(Serial);
+  
   // Small delay to prevent excessive CPU usage
   delay(10);
 }
\ No newline at end of file
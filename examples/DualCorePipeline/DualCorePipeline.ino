@@ -0,0 +1,125 @@
+/*
+ * DualCorePipeline
+ *
+ * Description:
+ * This example demonstrates how to run the AvantDigitalRead library as a two-stage pipeline on a
+ * dual-core ESP32. Sampling and debouncing run every millisecond in a task pinned to core 1, while
+ * the callbacks run in a task pinned to core 0. The single press callback deliberately blocks for
+ * 200 ms to stand in for a slow network call; button timing keeps working while it blocks because
+ * the sampling task never waits for callbacks.
+ *
+ * Author: AvantMaker <admin@avantmaker.com>
+ * Author Website: `https://www.AvantMaker.com`
+ * Date: 2026-10-16
+ * Version: 0.0.1
+ *
+ * Hardware Requirements:
+ * - Dual-core ESP32-based microcontroller (e.g., ESP32 DevKitC, DOIT ESP32 DevKit, etc.)
+ * - A button or switch connected to TEST_PIN
+ *
+ * Dependencies:
+ * - AvantDigitalRead library
+ *
+ *
+ * Usage Notes:
+ * 1. BUTTON CONNECTION:
+ *    - Connect one terminal of the button to the TEST_PIN (default pin 5)
+ *    - Connect the other terminal of the button to GROUND (GND)
+ *    - No external pull-up resistor is needed because we use INPUT_PULLUP
+ *
+ * 2. HOW THE PIPELINE WORKS:
+ *    - startPipeline(samplePeriodMs, samplingCore, dispatchCore) creates two FreeRTOS tasks
+ *    - The sampling task calls sample() every samplePeriodMs and puts events in a lock-free queue
+ *    - The dispatch task calls dispatch(), which runs the callbacks waiting in the queue
+ *    - Do NOT call update() in loop() while the pipeline is running
+ *    - getDroppedEvents() reports events lost because the dispatch task fell too far behind
+ *
+ * 3. UPLOAD AND USAGE:
+ *    - Upload this sketch to your ESP32 board
+ *    - Open the Serial Monitor (baud rate: 115200)
+ *    - Press the button quickly several times: every press is still recognized although each
+ *      single press callback blocks for 200 ms
+ *
+ * Compatibility: Tested with ESP32 DevKitC and DOIT ESP32 DevKit boards.
+ */
+
+#include "AvantDigitalRead.h"
+
+// Define the pin to monitor
+#define TEST_PIN 5
+
+// Create an instance of AvantDigitalRead
+AvantDigitalRead pinManager;
+
+// Callback function for single press events (runs on the dispatch core)
+void singlePressCallback(int pin, PinState newState, PinState oldState,
+                        EventType event, unsigned long timestamp) {
+  Serial.print("Pin ");
+  Serial.print(pin);
+  Serial.print(" SINGLE PRESS at ");
+  Serial.print(timestamp);
+  Serial.print(" ms, handled on core ");
+  Serial.println(xPortGetCoreID());
+
+  // Simulate a slow network call; sampling on the other core is not affected
+  delay(200);
+}
+
+// Callback function for long press events (runs on the dispatch core)
+void longPressCallback(int pin, PinState newState, PinState oldState,
+                      EventType event, unsigned long timestamp) {
+  Serial.print("Pin ");
+  Serial.print(pin);
+  Serial.print(" LONG PRESS at ");
+  Serial.print(timestamp);
+  Serial.println(" ms");
+}
+
+void setup() {
+  // Initialize serial communication
+  Serial.begin(115200);
+  while (!Serial) {
+    ; // Wait for serial port to connect
+  }
+
+  // Print welcome message
+  Serial.println("DualCorePipeline Example Starting...");
+  Serial.print("Monitoring pin for button presses: ");
+  Serial.println(TEST_PIN);
+  Serial.println("----------------------------------------");
+
+  // Initialize the pin to monitor
+  if (pinManager.addPin(TEST_PIN, INPUT_PULLUP)) {
+    Serial.println("Pin initialized successfully");
+  } else {
+    Serial.println("Failed to initialize pin");
+    while (1) {
+      delay(100); // Halt execution if pin initialization fails
+    }
+  }
+
+  // Set debounce time and register callbacks before starting the pipeline
+  pinManager.setDebounceTime(TEST_PIN, 30);
+  pinManager.onSinglePress(TEST_PIN, singlePressCallback);
+  pinManager.onLongPress(TEST_PIN, longPressCallback);
+
+  // Sample every 1 ms on core 1, run callbacks on core 0
+  if (pinManager.startPipeline(1, 1, 0)) {
+    Serial.println("Pipeline started: sampling on core 1, callbacks on core 0");
+  } else {
+    Serial.println("Failed to start pipeline");
+  }
+
+  Serial.println("----------------------------------------");
+}
+
+void loop() {
+  // No update() call here: the pipeline tasks do all the work
+  static unsigned long lastReport = 0;
+  if (millis() - lastReport >= 5000) {
+    lastReport = millis();
+    Serial.print("Dropped events so far: ");
+    Serial.println(pinManager.getDroppedEvents());
+  }
+  delay(100);
+}
@@ -0,0 +1,138 @@
+/*
+ * GestureProfiles
+ *
+ * Description:
+ * This example demonstrates how to share button timing between several pins with named gesture
+ * profiles in the AvantDigitalRead library. Four panel buttons use the "panel" profile, so their
+ * debounce time, click parameters, double press interval and long press duration are stored once
+ * and can be retuned for the whole group with a single call. A fifth button keeps its own timing.
+ *
+ * Author: AvantMaker <admin@avantmaker.com>
+ * Author Website: `https://www.AvantMaker.com`
+ * Date: 2026-10-16
+ * Version: 0.0.1
+ *
+ * Hardware Requirements:
+ * - ESP32-based microcontroller (e.g., ESP32 DevKitC, DOIT ESP32 DevKit, etc.)
+ * - Four buttons connected to the PANEL_PINS and one button connected to SPECIAL_PIN
+ *
+ * Dependencies:
+ * - AvantDigitalRead library
+ *
+ *
+ * Usage Notes:
+ * 1. BUTTON CONNECTION:
+ *    - Connect one terminal of each button to its pin (default pins 5, 18, 19, 21 and 22)
+ *    - Connect the other terminal of each button to GROUND (GND)
+ *    - No external pull-up resistor is needed because we use INPUT_PULLUP
+ *
+ * 2. HOW PROFILES WORK:
+ *    - addProfile(name) creates a profile with the default timing
+ *    - setProfileDebounceTime(), setProfileClickParameters(), setProfileDoublePressInterval() and
+ *      setProfileLongPress() change the timing of every pin using the profile at once
+ *    - setPinProfile(pin, name) makes a pin use a profile
+ *    - Per-pin settings (setDebounceTime(), setClickParameters(), and the timing arguments of
+ *      onDoublePress() and onLongPress()) give that pin its own timing again, so register the
+ *      callbacks before calling setPinProfile()
+ *
+ * 3. UPLOAD AND USAGE:
+ *    - Upload this sketch to your ESP32 board
+ *    - Open the Serial Monitor (baud rate: 115200)
+ *    - Press the panel buttons and the special button and compare how quickly they react
+ *    - Send 's' to switch the panel to slow timing, 'f' to switch it back to fast timing
+ *
+ * Compatibility: Tested with ESP32 DevKitC and DOIT ESP32 DevKit boards.
+ */
+
+#include "AvantDigitalRead.h"
+
+// Define the pins to monitor
+const int PANEL_PINS[] = {5, 18, 19, 21};
+const int PANEL_PIN_COUNT = sizeof(PANEL_PINS) / sizeof(PANEL_PINS[0]);
+#define SPECIAL_PIN 22
+
+// Create an instance of AvantDigitalRead
+AvantDigitalRead pinManager;
+
+// Callback function for all gesture events
+void gestureCallback(int pin, PinState newState, PinState oldState,
+                     EventType event, unsigned long timestamp) {
+  Serial.print("Pin ");
+  Serial.print(pin);
+  if (event == EVENT_SINGLE_PRESS) {
+    Serial.print(" SINGLE PRESS");
+  } else if (event == EVENT_DOUBLE_PRESS) {
+    Serial.print(" DOUBLE PRESS");
+  } else {
+    Serial.print(" LONG PRESS");
+  }
+  Serial.print(" at ");
+  Serial.print(timestamp);
+  Serial.println(" ms");
+}
+
+// Fast timing for the panel buttons
+void setFastPanel() {
+  pinManager.setProfileDebounceTime("panel", 20);
+  pinManager.setProfileClickParameters("panel", 30, 250);
+  pinManager.setProfileDoublePressInterval("panel", 250);
+  pinManager.setProfileLongPress("panel", 600);
+}
+
+// Slow timing for the panel buttons
+void setSlowPanel() {
+  pinManager.setProfileDebounceTime("panel", 50);
+  pinManager.setProfileClickParameters("panel", 80, 500);
+  pinManager.setProfileDoublePressInterval("panel", 500);
+  pinManager.setProfileLongPress("panel", 1500);
+}
+
+void setup() {
+  // Initialize serial communication
+  Serial.begin(115200);
+  while (!Serial) {
+    ; // Wait for serial port to connect
+  }
+
+  Serial.println("GestureProfiles Example Starting...");
+  Serial.println("----------------------------------------");
+
+  // Create the profile shared by the panel buttons
+  pinManager.addProfile("panel");
+  setFastPanel();
+
+  // Panel buttons: callbacks first, then the profile
+  for (int i = 0; i < PANEL_PIN_COUNT; i++) {
+    pinManager.addPin(PANEL_PINS[i], INPUT_PULLUP);
+    pinManager.onSinglePress(PANEL_PINS[i], gestureCallback);
+    pinManager.onDoublePress(PANEL_PINS[i], gestureCallback);
+    pinManager.onLongPress(PANEL_PINS[i], gestureCallback);
+    pinManager.setPinProfile(PANEL_PINS[i], "panel");
+  }
+
+  // Special button: its own timing
+  pinManager.addPin(SPECIAL_PIN, INPUT_PULLUP);
+  pinManager.setDebounceTime(SPECIAL_PIN, 40);
+  pinManager.onSinglePress(SPECIAL_PIN, gestureCallback);
+  pinManager.onLongPress(SPECIAL_PIN, gestureCallback, 0, 3000);
+
+  Serial.println("Send 's' for slow panel timing, 'f' for fast panel timing");
+  Serial.println("----------------------------------------");
+}
+
+void loop() {
+  // Retune the whole panel at once
+  if (Serial.available()) {
+    char command = Serial.read();
+    if (command == 's') {
+      setSlowPanel();
+      Serial.println("Panel timing: slow");
+    } else if (command == 'f') {
+      setFastPanel();
+      Serial.println("Panel timing: fast");
+    }
+  }
+
+  // Update all pin states and process events
+  pinManager.update();
+}
@@ -0,0 +1,97 @@
+/*
+ * PulseCounter
+ *
+ * Description:
+ * This example demonstrates the pulse counter mode of the AvantDigitalRead library with a
+ * hall-effect water flow sensor. The library counts the sensor pulses itself, without a
+ * callback per pulse, and once per second reports the total volume, the flow from the pulse
+ * frequency and the flow from the pulses counted in the last second. Pulses are not lost
+ * while the loop is busy, because the pins are read by timer sampling.
+ *
+ * Author: AvantMaker <admin@avantmaker.com>
+ * Author Website: `https://www.AvantMaker.com`
+ * Date: 2026-10-16
+ * Version: 0.0.1
+ *
+ * Hardware Requirements:
+ * - ESP32-based microcontroller (e.g., ESP32 DevKitC, DOIT ESP32 DevKit, etc.)
+ * - A hall-effect flow sensor (e.g., YF-S201) or any pulse output such as an S0 energy meter
+ *
+ * Dependencies:
+ * - AvantDigitalRead library
+ *
+ *
+ * Usage Notes:
+ * 1. CONNECTION:
+ *    - Connect the sensor signal to FLOW_SENSOR_PIN (default pin 27), with a pull-up to 3.3V
+ *      if the output is open collector (the internal pull-up is used by default)
+ *    - Power the sensor as specified by its datasheet; divide 5V outputs down to 3.3V
+ *
+ * 2. HOW THE COUNTER WORKS:
+ *    - setPulseCounter(pin, EVENT_RISING, windowMs, callback) counts rising edges and calls
+ *      back with EVENT_PULSE_REPORT at the end of each window
+ *    - getPulseCount() returns a 64-bit total, getPulseFrequency() the frequency from the
+ *      average pulse period, getPulseRate() the pulses per second of the last window
+ *    - Set PULSES_PER_LITER to the value of your sensor (YF-S201: about 450)
+ *
+ * 3. UPLOAD AND USAGE:
+ *    - Upload this sketch to your ESP32 board
+ *    - Open the Serial Monitor (baud rate: 115200)
+ *    - Let water flow through the sensor and watch the volume and flow
+ *
+ * Compatibility: Tested with ESP32 DevKitC and DOIT ESP32 DevKit boards.
+ */
+
+#include "AvantDigitalRead.h"
+
+// Define the pin
+#define FLOW_SENSOR_PIN 27
+
+// Sensor calibration
+const float PULSES_PER_LITER = 450.0;
+
+// Create an instance of AvantDigitalRead
+AvantDigitalRead pinManager;
+
+// Window ended: print volume and flow
+void reportCallback(int pin, PinState newState, PinState oldState,
+                    EventType event, unsigned long timestamp) {
+  float liters = pinManager.getPulseCount(pin) / PULSES_PER_LITER;
+  float flowFromFrequency = pinManager.getPulseFrequency(pin) * 60.0 / PULSES_PER_LITER;
+  float flowFromRate = pinManager.getPulseRate(pin) * 60.0 / PULSES_PER_LITER;
+
+  Serial.print("Volume: ");
+  Serial.print(liters, 3);
+  Serial.print(" L  Flow: ");
+  Serial.print(flowFromFrequency, 2);
+  Serial.print(" L/min (frequency), ");
+  Serial.print(flowFromRate, 2);
+  Serial.println(" L/min (last second)");
+}
+
+void setup() {
+  // Initialize serial communication
+  Serial.begin(115200);
+  while (!Serial) {
+    ; // Wait for serial port to connect
+  }
+
+  Serial.println("PulseCounter Example Starting...");
+  Serial.println("----------------------------------------");
+
+  // Hall sensors have clean edges: no debounce, so pulses of 1-2 ms are still counted
+  pinManager.addPin(FLOW_SENSOR_PIN, INPUT_PULLUP);
+  pinManager.setDebounceTime(FLOW_SENSOR_PIN, 0);
+  pinManager.setPulseCounter(FLOW_SENSOR_PIN, EVENT_RISING, 1000, reportCallback);
+
+  // Read the pin at a fixed rate, independent of the loop
+  pinManager.beginTimerSampling(2000);
+
+  Serial.println("----------------------------------------");
+}
+
+void loop() {
+  // Processes the buffered samples; a slow loop delays the reports but loses no pulses
+  pinManager.update();
+  delay(50);
+}
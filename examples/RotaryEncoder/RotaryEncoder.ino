@@ -0,0 +1,106 @@
+/*
+ * RotaryEncoder
+ *
+ * Description:
+ * This example demonstrates the quadrature rotary encoder support of the AvantDigitalRead
+ * library. A typical HMI knob (a mechanical encoder with a push switch) adjusts a value
+ * between VALUE_MIN and VALUE_MAX, turning fast moves the value in larger steps, and pressing
+ * the knob resets it. The encoder and the switch are read in the same update() pass, so no
+ * separate encoder library reads the pins.
+ *
+ * Author: AvantMaker <admin@avantmaker.com>
+ * Author Website: `https://www.AvantMaker.com`
+ * Date: 2026-10-16
+ * Version: 0.0.1
+ *
+ * Hardware Requirements:
+ * - ESP32-based microcontroller (e.g., ESP32 DevKitC, DOIT ESP32 DevKit, etc.)
+ * - A rotary encoder with push switch (e.g., KY-040 or a bare EC11)
+ *
+ * Dependencies:
+ * - AvantDigitalRead library
+ *
+ *
+ * Usage Notes:
+ * 1. CONNECTION:
+ *    - Connect the encoder outputs A and B to ENCODER_A_PIN (default pin 18) and
+ *      ENCODER_B_PIN (default pin 19), the common terminal to GND
+ *    - Connect the push switch between ENCODER_SWITCH_PIN (default pin 5) and GND
+ *
+ * 2. HOW THE ENCODER WORKS:
+ *    - addEncoder(pinA, pinB, callback) adds both pins and calls back with EVENT_ENCODER once
+ *      per detent; newState is PIN_HIGH when the position went up, PIN_LOW when it went down
+ *    - Most encoders have 4 steps per detent; pass 2 or 1 as fourth argument for others
+ *    - setEncoderAcceleration(pinA, accelerationMs, maxStep) makes detents closer than
+ *      accelerationMs move the position by up to maxStep
+ *    - If the value goes the wrong way, swap the A and B pins
+ *
+ * 3. UPLOAD AND USAGE:
+ *    - Upload this sketch to your ESP32 board
+ *    - Open the Serial Monitor (baud rate: 115200)
+ *    - Turn the knob slowly and quickly, press it to reset the value
+ *
+ * Compatibility: Tested with ESP32 DevKitC and DOIT ESP32 DevKit boards.
+ */
+
+#include "AvantDigitalRead.h"
+
+// Define the pins
+#define ENCODER_A_PIN 18
+#define ENCODER_B_PIN 19
+#define ENCODER_SWITCH_PIN 5
+
+// Value range
+const long VALUE_MIN = 0;
+const long VALUE_MAX = 1000;
+
+// Create an instance of AvantDigitalRead
+AvantDigitalRead pinManager;
+
+// Knob turned: use the position as value, kept within its range
+void encoderCallback(int pin, PinState newState, PinState oldState,
+                     EventType event, unsigned long timestamp) {
+  long value = pinManager.getEncoderPosition(pin);
+  if (value < VALUE_MIN || value > VALUE_MAX) {
+    value = value < VALUE_MIN ? VALUE_MIN : VALUE_MAX;
+    pinManager.setEncoderPosition(pin, value);
+  }
+  Serial.print(newState == PIN_HIGH ? "Up   " : "Down ");
+  Serial.print("value: ");
+  Serial.println(value);
+}
+
+// Knob pressed: reset the value
+void switchCallback(int pin, PinState newState, PinState oldState,
+                    EventType event, unsigned long timestamp) {
+  pinManager.setEncoderPosition(ENCODER_A_PIN, 0);
+  Serial.println("Value reset");
+}
+
+void setup() {
+  // Initialize serial communication
+  Serial.begin(115200);
+  while (!Serial) {
+    ; // Wait for serial port to connect
+  }
+
+  Serial.println("RotaryEncoder Example Starting...");
+  Serial.println("----------------------------------------");
+
+  // Encoder: one callback per detent, up to 10 per detent when turned fast
+  if (!pinManager.addEncoder(ENCODER_A_PIN, ENCODER_B_PIN, encoderCallback)) {
+    Serial.println("Failed to add the encoder");
+  }
+  pinManager.setEncoderAcceleration(ENCODER_A_PIN, 60, 10);
+
+  // Push switch
+  pinManager.addPin(ENCODER_SWITCH_PIN, INPUT_PULLUP);
+  pinManager.onSinglePress(ENCODER_SWITCH_PIN, switchCallback);
+
+  Serial.println("----------------------------------------");
+}
+
+void loop() {
+  // Read the encoder and the switch in one pass; call often, a fast turn makes a step every few ms
+  pinManager.update();
+}
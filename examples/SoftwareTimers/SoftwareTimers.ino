@@ -0,0 +1,141 @@
+/*
+ * SoftwareTimers
+ *
+ * Description:
+ * This example demonstrates the software timers of the AvantDigitalRead library. A PIR motion
+ * sensor keeps a light on until no motion has been seen for OCCUPANCY_TIMEOUT_MS (a retriggerable
+ * timer), a button turns a fan on and starts a one-shot timer that switches it off again after
+ * FAN_RUN_MS, and a periodic timer prints a status line every STATUS_PERIOD_MS. No millis()
+ * bookkeeping is needed in the sketch.
+ *
+ * Author: AvantMaker <admin@avantmaker.com>
+ * Author Website: `https://www.AvantMaker.com`
+ * Date: 2026-10-16
+ * Version: 0.0.1
+ *
+ * Hardware Requirements:
+ * - ESP32-based microcontroller (e.g., ESP32 DevKitC, DOIT ESP32 DevKit, etc.)
+ * - A PIR motion sensor connected to PIR_PIN
+ * - A button connected to FAN_BUTTON_PIN
+ * - Optional: LEDs on LIGHT_PIN and FAN_PIN
+ *
+ * Dependencies:
+ * - AvantDigitalRead library
+ *
+ *
+ * Usage Notes:
+ * 1. CONNECTION:
+ *    - Connect the PIR output to PIR_PIN (default pin 4), it drives the pin HIGH on motion
+ *    - Connect one terminal of the button to FAN_BUTTON_PIN (default pin 5), the other to GND
+ *
+ * 2. HOW THE TIMERS WORK:
+ *    - retriggerTimer(pin, trigger, callback, timeoutMs) calls back timeoutMs after the last
+ *      trigger event of the pin; every new trigger restarts the wait
+ *    - startTimer(pin, callback, delayMs) calls back once after delayMs with EVENT_TIMER,
+ *      startTimer(pin, callback, delayMs, periodMs) keeps calling back every periodMs
+ *    - restartTimer(handle) counts the delay again from now, cancel(handle) stops a timer
+ *
+ * 3. UPLOAD AND USAGE:
+ *    - Upload this sketch to your ESP32 board
+ *    - Open the Serial Monitor (baud rate: 115200)
+ *    - Move in front of the PIR sensor and press the button
+ *
+ * Compatibility: Tested with ESP32 DevKitC and DOIT ESP32 DevKit boards.
+ */
+
+#include "AvantDigitalRead.h"
+
+// Define the pins
+#define PIR_PIN 4
+#define FAN_BUTTON_PIN 5
+#define LIGHT_PIN 2
+#define FAN_PIN 15
+
+// Timer settings
+const unsigned long OCCUPANCY_TIMEOUT_MS = 30000;
+const unsigned long FAN_RUN_MS = 10000;
+const unsigned long STATUS_PERIOD_MS = 5000;
+
+// Create an instance of AvantDigitalRead
+AvantDigitalRead pinManager;
+
+// Timer switching the fan off
+CallbackHandle fanTimer = 0;
+
+// Motion: light on
+void motionCallback(int pin, PinState newState, PinState oldState,
+                    EventType event, unsigned long timestamp) {
+  digitalWrite(LIGHT_PIN, HIGH);
+  Serial.println("Motion, light on");
+}
+
+// No motion for OCCUPANCY_TIMEOUT_MS: light off
+void vacancyCallback(int pin, PinState newState, PinState oldState,
+                     EventType event, unsigned long timestamp) {
+  digitalWrite(LIGHT_PIN, LOW);
+  Serial.println("Room empty, light off");
+}
+
+// Fan run time over
+void fanOffCallback(int pin, PinState newState, PinState oldState,
+                    EventType event, unsigned long timestamp) {
+  digitalWrite(FAN_PIN, LOW);
+  fanTimer = 0;
+  Serial.println("Fan off");
+}
+
+// Button: fan on, or run it for another FAN_RUN_MS if it is already on
+void fanButtonCallback(int pin, PinState newState, PinState oldState,
+                       EventType event, unsigned long timestamp) {
+  if (fanTimer != 0 && pinManager.restartTimer(fanTimer)) {
+    Serial.println("Fan run time extended");
+    return;
+  }
+  digitalWrite(FAN_PIN, HIGH);
+  fanTimer = pinManager.startTimer(FAN_BUTTON_PIN, fanOffCallback, FAN_RUN_MS);
+  Serial.println("Fan on");
+}
+
+// Periodic status line
+void statusCallback(int pin, PinState newState, PinState oldState,
+                    EventType event, unsigned long timestamp) {
+  Serial.print("Status at ");
+  Serial.print(timestamp);
+  Serial.print(" ms: PIR ");
+  Serial.print(newState == PIN_HIGH ? "active" : "idle");
+  Serial.print(", pending timers: ");
+  Serial.println(pinManager.getPendingCallbacks());
+}
+
+void setup() {
+  // Initialize serial communication
+  Serial.begin(115200);
+  while (!Serial) {
+    ; // Wait for serial port to connect
+  }
+
+  Serial.println("SoftwareTimers Example Starting...");
+  Serial.println("----------------------------------------");
+
+  pinMode(LIGHT_PIN, OUTPUT);
+  pinMode(FAN_PIN, OUTPUT);
+
+  // PIR: light on at once, off OCCUPANCY_TIMEOUT_MS after the last motion
+  pinManager.addPin(PIR_PIN, INPUT);
+  pinManager.onRising(PIR_PIN, motionCallback);
+  pinManager.retriggerTimer(PIR_PIN, EVENT_RISING, vacancyCallback, OCCUPANCY_TIMEOUT_MS);
+
+  // Fan button
+  pinManager.addPin(FAN_BUTTON_PIN, INPUT_PULLUP);
+  pinManager.onSinglePress(FAN_BUTTON_PIN, fanButtonCallback);
+
+  // Status line every STATUS_PERIOD_MS, reporting the PIR level
+  pinManager.startTimer(PIR_PIN, statusCallback, STATUS_PERIOD_MS, STATUS_PERIOD_MS);
+
+  Serial.println("----------------------------------------");
+}
+
+void loop() {
+  // Update all pin states and run the timers that are due
+  pinManager.update();
+}
@@ -0,0 +1,205 @@
+/*
+ * Arduino.h (host stand-in)
+ *
+ * Description:
+ * Minimal replacement for the Arduino core that lets AvantDigitalRead and the
+ * tools under extras/tools be compiled and exercised on Linux. Pin levels are
+ * held in memory and driven by the test program through hostSetPin(), and the
+ * clock can either follow the real monotonic clock or be advanced manually for
+ * deterministic simulations.
+ *
+ * This folder is never compiled by the Arduino IDE. To build a host program:
+ *   g++ -std=c++17 -O2 -pthread -Iextras/host -Isrc program.cpp src/AvantDigitalRead.cpp
+ */
+
+#ifndef AVANTDIGITALREAD_HOST_ARDUINO_H
+#define AVANTDIGITALREAD_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#define LOW 0x0
+#define HIGH 0x1
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define PULLUP 0x04
+#define INPUT_PULLUP 0x05
+#define PULLDOWN 0x08
+#define INPUT_PULLDOWN 0x09
+
+#define DEC 10
+#define HEX 16
+
+// Number of simulated pins
+const int HOST_PIN_COUNT = 256;
+
+// Simulated hardware state shared by every translation unit
+struct HostState {
+  std::atomic<uint8_t> levels[HOST_PIN_COUNT];
+  std::atomic<bool> simulatedClock;
+  std::atomic<uint64_t> simulatedMicros;
+  std::chrono::steady_clock::time_point start;
+
+  HostState() : simulatedClock(false), simulatedMicros(0),
+                start(std::chrono::steady_clock::now()) {
+    for (int i = 0; i < HOST_PIN_COUNT; i++) {
+      levels[i].store(LOW, std::memory_order_relaxed);
+    }
+  }
+};
+
+inline HostState& hostState() {
+  static HostState state;
+  return state;
+}
+
+// Current time in microseconds since start (64-bit, never wraps)
+inline uint64_t hostMicros64() {
+  HostState& state = hostState();
+  if (state.simulatedClock.load(std::memory_order_acquire)) {
+    return state.simulatedMicros.load(std::memory_order_acquire);
+  }
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - state.start).count();
+}
+
+// Switch to a manually advanced clock starting at the given time
+inline void hostUseSimulatedClock(uint64_t startMicros = 0) {
+  hostState().simulatedMicros.store(startMicros, std::memory_order_release);
+  hostState().simulatedClock.store(true, std::memory_order_release);
+}
+
+// Switch back to the real monotonic clock
+inline void hostUseRealClock() {
+  hostState().simulatedClock.store(false, std::memory_order_release);
+}
+
+// Set the simulated clock (only meaningful with the simulated clock)
+inline void hostSetMicros(uint64_t micros) {
+  hostState().simulatedMicros.store(micros, std::memory_order_release);
+}
+
+// Advance the simulated clock
+inline void hostAdvanceMicros(uint64_t micros) {
+  hostState().simulatedMicros.fetch_add(micros, std::memory_order_acq_rel);
+}
+
+// Drive the level seen by digitalRead()
+inline void hostSetPin(int pin, int level) {
+  if (pin >= 0 && pin < HOST_PIN_COUNT) {
+    hostState().levels[pin].store(level ? HIGH : LOW, std::memory_order_release);
+  }
+}
+
+inline unsigned long millis() {
+  return (unsigned long)(hostMicros64() / 1000);
+}
+
+inline unsigned long micros() {
+  return (unsigned long)(uint32_t)hostMicros64();
+}
+
+inline void delay(unsigned long ms) {
+  if (hostState().simulatedClock.load(std::memory_order_acquire)) {
+    hostAdvanceMicros((uint64_t)ms * 1000);
+  } else {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  }
+}
+
+inline void delayMicroseconds(unsigned int us) {
+  if (hostState().simulatedClock.load(std::memory_order_acquire)) {
+    hostAdvanceMicros(us);
+  } else {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+  }
+}
+
+inline void pinMode(int pin, int mode) {
+  // A pulled-up input idles HIGH, like an open button on real hardware
+  if ((mode & PULLUP) != 0) {
+    hostSetPin(pin, HIGH);
+  }
+}
+
+inline int digitalRead(int pin) {
+  if (pin < 0 || pin >= HOST_PIN_COUNT) {
+    return LOW;
+  }
+  return hostState().levels[pin].load(std::memory_order_acquire);
+}
+
+// Subset of the Arduino Print class used by the library and the host tools
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+      n += write(*buffer++);
+    }
+    return n;
+  }
+  size_t write(const char* str) {
+    return str == nullptr ? 0 : write((const uint8_t*)str, strlen(str));
+  }
+
+  size_t print(const char* str) { return write(str); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int value, int base = DEC) { return print((long)value, base); }
+  size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(long value, int base = DEC) { return print((long long)value, base); }
+  size_t print(unsigned long value, int base = DEC) { return print((unsigned long long)value, base); }
+  size_t print(long long value, int base = DEC) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), base == HEX ? "%llx" : "%lld", value);
+    return write(buf);
+  }
+  size_t print(unsigned long long value, int base = DEC) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), base == HEX ? "%llx" : "%llu", value);
+    return write(buf);
+  }
+  size_t print(double value, int digits = 2) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", digits, value);
+    return write(buf);
+  }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(T value) { size_t n = print(value); return n + println(); }
+  template <typename T>
+  size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+};
+
+// Print that writes to a stdio stream
+class HostFilePrint : public Print {
+public:
+  explicit HostFilePrint(FILE* file) : file(file) {}
+  size_t write(uint8_t c) override { return fputc(c, file) == EOF ? 0 : 1; }
+  size_t write(const uint8_t* buffer, size_t size) override { return fwrite(buffer, 1, size, file); }
+  using Print::write;
+
+private:
+  FILE* file;
+};
+
+// Serial stand-in writing to stdout
+class HostSerial : public HostFilePrint {
+public:
+  HostSerial() : HostFilePrint(stdout) {}
+  void begin(unsigned long) {}
+  explicit operator bool() const { return true; }
+};
+
+inline HostSerial Serial;
+
+#endif // AVANTDIGITALREAD_HOST_ARDUINO_H
@@ -0,0 +1,250 @@
+/*
+ * AvantBounceGenerator.h (host only)
+ *
+ * Description:
+ * Seeded generator of realistic switch waveforms for benchmarking debounce and
+ * gesture detection on the host. Each generator produces, for one pin, a stream
+ * of human gestures (single, double and long presses) with press lengths and
+ * inter-click gaps drawn from normal distributions. Every transition is
+ * surrounded by contact bounce drawn from a per-profile bounce count and pulse
+ * width distribution, and noise glitches can be injected between transitions.
+ *
+ * Edges are produced lazily one gesture at a time, so memory use is constant no
+ * matter how many presses are simulated. The same seed always yields the same
+ * waveform.
+ */
+
+#ifndef AVANTBOUNCEGENERATOR_H
+#define AVANTBOUNCEGENERATOR_H
+
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+
+// Waveform characteristics of one kind of input
+struct BounceProfile {
+  const char* name;
+  // Contact bounce around each transition
+  uint8_t minBounces;           // Bounce pulses per transition
+  uint8_t maxBounces;
+  uint32_t minBounceUs;         // Width of each bounce pulse
+  uint32_t maxBounceUs;
+  // Glitches while the contact is otherwise stable (long cable runs, EMI)
+  float glitchesPerSecond;
+  uint32_t minGlitchUs;
+  uint32_t maxGlitchUs;
+  // Human timing
+  float pressMeanMs;            // Single/double click press length
+  float pressStdDevMs;
+  float gapMeanMs;              // Release-to-press gap inside a double press
+  float gapStdDevMs;
+  float longPressMeanMs;        // Hold time of a long press
+  float longPressStdDevMs;
+  float idleMinMs;              // Quiet time between gestures
+  float idleMaxMs;
+  // Gesture mix (the rest are single presses)
+  float doubleShare;
+  float longShare;
+};
+
+// Built-in profiles
+const BounceProfile BOUNCE_PROFILE_CLEAN = {
+  "clean", 0, 0, 0, 0, 0.0f, 0, 0,
+  120.0f, 40.0f, 150.0f, 50.0f, 1500.0f, 300.0f, 1000.0f, 2000.0f, 0.25f, 0.15f
+};
+const BounceProfile BOUNCE_PROFILE_MECHANICAL = {
+  "mechanical", 3, 12, 20, 800, 0.0f, 0, 0,
+  120.0f, 40.0f, 150.0f, 50.0f, 1500.0f, 300.0f, 1000.0f, 2000.0f, 0.25f, 0.15f
+};
+const BounceProfile BOUNCE_PROFILE_REED = {
+  "reed", 1, 3, 200, 3000, 0.0f, 0, 0,
+  150.0f, 50.0f, 180.0f, 60.0f, 1500.0f, 300.0f, 1000.0f, 2000.0f, 0.20f, 0.20f
+};
+const BounceProfile BOUNCE_PROFILE_NOISY_CABLE = {
+  "noisy-cable", 3, 12, 20, 800, 4.0f, 50, 4000,
+  120.0f, 40.0f, 150.0f, 50.0f, 1500.0f, 300.0f, 1000.0f, 2000.0f, 0.25f, 0.15f
+};
+
+// Gesture the simulated human intended
+enum IntendedGesture {
+  INTENDED_SINGLE,
+  INTENDED_DOUBLE,
+  INTENDED_LONG
+};
+
+// One level change of the generated waveform
+struct BounceEdge {
+  uint64_t timeUs;
+  uint8_t level;
+};
+
+// Ground truth for the gesture currently being generated
+struct GestureTruth {
+  IntendedGesture gesture;
+  uint64_t startUs;      // First edge of the gesture
+  uint64_t completeUs;   // When the gesture is physically complete (release, or hold threshold for long presses)
+  uint64_t pressUs[2];   // Press-to-release time of each click (the second is 0 unless it is a double press)
+  uint64_t intervalUs;   // Release-to-release time of a double press (0 otherwise)
+};
+
+class AvantBounceGenerator {
+public:
+  // idleLevel is the released level (HIGH for INPUT_PULLUP buttons)
+  AvantBounceGenerator(uint64_t seed, const BounceProfile& profile, uint8_t idleLevel = 1,
+                       float longPressThresholdMs = 1000.0f)
+    : state(seed ? seed : 0x9E3779B97F4A7C15ULL), profile(profile), idleLevel(idleLevel),
+      longThresholdMs(longPressThresholdMs), clockUs(0), next(0) {
+    edges.reserve(256);
+    current.gesture = INTENDED_SINGLE;
+    current.startUs = 0;
+    current.completeUs = 0;
+    current.pressUs[0] = current.pressUs[1] = 0;
+    current.intervalUs = 0;
+  }
+
+  // Next edge of the waveform; starts a new gesture when the current one is used up
+  const BounceEdge& nextEdge() {
+    if (next == edges.size()) {
+      generateGesture();
+    }
+    return edges[next++];
+  }
+
+  // Peek at the time of the next edge
+  uint64_t peekTimeUs() {
+    if (next == edges.size()) {
+      generateGesture();
+    }
+    return edges[next].timeUs;
+  }
+
+  // Ground truth of the most recently generated gesture. Glitch edges in the quiet
+  // time before it come first; the gesture itself starts at truth().startUs.
+  const GestureTruth& truth() const {
+    return current;
+  }
+
+private:
+  // xorshift64* pseudo-random numbers
+  uint64_t nextRandom() {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+  }
+  double uniform() {
+    return (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+  }
+  uint32_t uniformInt(uint32_t low, uint32_t high) {
+    return high <= low ? low : low + (uint32_t)(nextRandom() % (uint64_t)(high - low + 1));
+  }
+  double normal(double mean, double stdDev) {
+    // Box-Muller
+    double u1 = uniform();
+    double u2 = uniform();
+    if (u1 < 1e-12) {
+      u1 = 1e-12;
+    }
+    return mean + stdDev * sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+  }
+  uint64_t positiveMs(double mean, double stdDev, double minimum) {
+    double value = normal(mean, stdDev);
+    return (uint64_t)((value < minimum ? minimum : value) * 1000.0);
+  }
+
+  // Transition to level at timeUs with contact bounce; returns when the contact settles
+  uint64_t addTransition(uint64_t timeUs, uint8_t level) {
+    uint32_t bounces = uniformInt(profile.minBounces, profile.maxBounces);
+    uint64_t t = timeUs;
+    for (uint32_t i = 0; i < bounces; i++) {
+      edges.push_back({t, level});
+      t += uniformInt(profile.minBounceUs, profile.maxBounceUs);
+      edges.push_back({t, (uint8_t)!level});
+      t += uniformInt(profile.minBounceUs, profile.maxBounceUs);
+    }
+    edges.push_back({t, level});
+    return t;
+  }
+
+  // Stable period at level from fromUs to toUs, with optional glitches
+  void addStable(uint64_t fromUs, uint64_t toUs, uint8_t level) {
+    if (profile.glitchesPerSecond <= 0.0f) {
+      return;
+    }
+    double meanGapUs = 1000000.0 / profile.glitchesPerSecond;
+    uint64_t t = fromUs + (uint64_t)(-log(1.0 - uniform()) * meanGapUs);
+    while (t + profile.maxGlitchUs < toUs) {
+      uint32_t width = uniformInt(profile.minGlitchUs, profile.maxGlitchUs);
+      edges.push_back({t, (uint8_t)!level});
+      edges.push_back({t + width, level});
+      t += width + (uint64_t)(-log(1.0 - uniform()) * meanGapUs);
+    }
+  }
+
+  // One click: press, hold, release; returns the release time
+  uint64_t addClick(uint64_t pressUs, uint64_t holdUs, uint64_t& releaseUs) {
+    uint8_t pressed = (uint8_t)!idleLevel;
+    uint64_t settled = addTransition(pressUs, pressed);
+    releaseUs = pressUs + holdUs;
+    if (releaseUs <= settled) {
+      releaseUs = settled + 1;
+    }
+    addStable(settled, releaseUs, pressed);
+    return addTransition(releaseUs, idleLevel);
+  }
+
+  void generateGesture() {
+    edges.clear();
+    next = 0;
+
+    // Quiet time (with glitches) before the gesture
+    uint64_t idleUs = (uint64_t)((profile.idleMinMs + uniform() * (profile.idleMaxMs - profile.idleMinMs)) * 1000.0);
+    uint64_t startUs = clockUs + idleUs;
+    addStable(clockUs, startUs, idleLevel);
+
+    double pick = uniform();
+    uint64_t releaseUs = 0;
+    uint64_t settled;
+    current.startUs = startUs;
+    current.pressUs[1] = 0;
+    current.intervalUs = 0;
+    if (pick < profile.longShare) {
+      current.gesture = INTENDED_LONG;
+      uint64_t holdUs = positiveMs(profile.longPressMeanMs, profile.longPressStdDevMs, longThresholdMs * 1.1);
+      settled = addClick(startUs, holdUs, releaseUs);
+      current.pressUs[0] = releaseUs - startUs;
+      current.completeUs = startUs + (uint64_t)(longThresholdMs * 1000.0);
+    } else if (pick < profile.longShare + profile.doubleShare) {
+      current.gesture = INTENDED_DOUBLE;
+      settled = addClick(startUs, positiveMs(profile.pressMeanMs, profile.pressStdDevMs, 10.0), releaseUs);
+      current.pressUs[0] = releaseUs - startUs;
+      uint64_t firstReleaseUs = releaseUs;
+      uint64_t secondUs = releaseUs + positiveMs(profile.gapMeanMs, profile.gapStdDevMs, 10.0);
+      if (secondUs <= settled) {
+        secondUs = settled + 1;
+      }
+      addStable(settled, secondUs, idleLevel);
+      settled = addClick(secondUs, positiveMs(profile.pressMeanMs, profile.pressStdDevMs, 10.0), releaseUs);
+      current.pressUs[1] = releaseUs - secondUs;
+      current.intervalUs = releaseUs - firstReleaseUs;
+      current.completeUs = releaseUs;
+    } else {
+      current.gesture = INTENDED_SINGLE;
+      settled = addClick(startUs, positiveMs(profile.pressMeanMs, profile.pressStdDevMs, 10.0), releaseUs);
+      current.pressUs[0] = releaseUs - startUs;
+      current.completeUs = releaseUs;
+    }
+    clockUs = settled;
+  }
+
+  uint64_t state;
+  BounceProfile profile;
+  uint8_t idleLevel;
+  float longThresholdMs;
+  uint64_t clockUs;               // End of the last generated gesture
+  std::vector<BounceEdge> edges;  // Edges of the current gesture, reused
+  size_t next;                    // Next edge to return
+  GestureTruth current;
+};
+
+#endif // AVANTBOUNCEGENERATOR_H
@@ -0,0 +1,358 @@
+/*
+ * BounceBench
+ *
+ * Description:
+ * Host benchmark that drives the host pin stand-in with synthetic waveforms from
+ * AvantBounceGenerator (clean, mechanical, reed and noisy-cable profiles, one pin
+ * each) and reports, for every setDebounceTime()/setClickParameters() combination,
+ * how many intended gestures were recognized, missed or accompanied by false
+ * events, how many spurious edges got through, and the detection latency.
+ *
+ * Gestures whose generated timing falls outside the configured window (a press
+ * shorter or longer than setClickParameters() allows, a double press slower than
+ * the double press interval, a hold shorter than the long press duration) are
+ * counted as "outside" instead of being scored, so the missed and false columns
+ * measure debounce quality rather than the spread of the generated timing.
+ *
+ * The simulation is event driven and feeds the waveform to processSample(). The
+ * pins do not interact, so each one runs on its own AvantDigitalRead instance in
+ * its own thread. A heap holds the instants where a debounce, long press or double
+ * press window can expire; the next event is the earlier of its top and the next
+ * edge of the generator. The edges of one millisecond are folded into one pass (two
+ * when the pin ends up at the level it started from), and edges that are followed
+ * by another one within the debounce time of the last edge passed on are left out,
+ * since the library cannot accept a level in between. Both give the same results as
+ * processing every edge on its own (the library counts time in milliseconds), at a
+ * fraction of the cost. The throughput is compared with a target of one million
+ * simulated presses per second.
+ *
+ * Build (from the repository root):
+ *   g++ -std=c++17 -O2 -pthread -Iextras/host -Isrc \
+ *       extras/tools/BounceBench/BounceBench.cpp src/AvantDigitalRead.cpp -o BounceBench
+ *
+ * Usage:
+ *   ./BounceBench [--gestures N] [--seed S] [--debounce 5,10,20,50] [--click 50:300,30:400]
+ *                 [--interval MS] [--long-press MS]
+ */
+
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AvantDigitalRead.h"
+#include "AvantBounceGenerator.h"
+
+// Events detected for the gesture currently being simulated on a pin
+struct GestureCount {
+  unsigned long events[EVENT_LONG_PRESS + 1];
+  unsigned long firstDetectMs[EVENT_LONG_PRESS + 1];
+};
+
+// Accumulated results for one profile
+struct ProfileStats {
+  unsigned long gestures;
+  unsigned long clicks;
+  unsigned long outside;
+  unsigned long correct;
+  unsigned long missed;
+  unsigned long falseEvents;
+  unsigned long falseEdges;
+  double latencySumMs;
+  double latencyMaxMs;
+  unsigned long latencyCount;
+};
+
+// Instants where a window may expire, earliest on top
+typedef std::priority_queue<uint64_t, std::vector<uint64_t>, std::greater<uint64_t> > CheckQueue;
+
+// Simulation state of one pin
+struct PinSim {
+  AvantBounceGenerator generator;
+  const BounceProfile* profile;
+  GestureTruth truth;
+  bool hasTruth;
+  GestureCount count;
+  ProfileStats stats;
+  CheckQueue windowChecks;
+};
+
+// Throughput the benchmark is expected to reach
+const double TARGET_PRESSES_PER_SECOND = 1000000.0;
+
+static std::vector<PinSim>* sims = nullptr;
+
+// Configured gesture windows: when to look for an expiry, and which generated timing the library rejects
+struct GestureWindow {
+  unsigned long minPressMs;
+  unsigned long maxPressMs;
+  unsigned long maxIntervalMs;
+  unsigned long pressDurationMs;
+};
+static GestureWindow window;
+
+// Count every event on the gesture in progress
+void countEvent(int pin, PinState newState, PinState oldState,
+                EventType event, unsigned long timestamp) {
+  (void)oldState;
+  PinSim& sim = (*sims)[pin];
+  if (sim.count.events[event]++ == 0) {
+    sim.count.firstDetectMs[event] = timestamp;
+  }
+  if (event == EVENT_CHANGE) {
+    // Only debounced transitions open gesture windows; bounce edges never do. A press
+    // opens the long press window, a release the double press window.
+    unsigned long windowEndMs = newState == PIN_LOW ? window.pressDurationMs : window.maxIntervalMs + 1;
+    sim.windowChecks.push((uint64_t)(timestamp + windowEndMs) * 1000);
+  }
+}
+
+// Whether the generated timing of a gesture is one the configured windows accept
+static bool insideWindow(const GestureTruth& truth) {
+  if (truth.gesture == INTENDED_LONG) {
+    return truth.pressUs[0] >= (uint64_t)window.pressDurationMs * 1000;
+  }
+  int clicks = truth.gesture == INTENDED_DOUBLE ? 2 : 1;
+  for (int i = 0; i < clicks; i++) {
+    if (truth.pressUs[i] < (uint64_t)window.minPressMs * 1000 ||
+        truth.pressUs[i] > (uint64_t)window.maxPressMs * 1000) {
+      return false;
+    }
+  }
+  return clicks == 1 || truth.intervalUs <= (uint64_t)window.maxIntervalMs * 1000;
+}
+
+// Compare the events seen during a gesture with what the human intended
+static void finishGesture(PinSim& sim) {
+  if (!sim.hasTruth) {
+    return;
+  }
+  sim.hasTruth = false;
+  ProfileStats& stats = sim.stats;
+  GestureCount& count = sim.count;
+  EventType expected = sim.truth.gesture == INTENDED_SINGLE ? EVENT_SINGLE_PRESS :
+                       sim.truth.gesture == INTENDED_DOUBLE ? EVENT_DOUBLE_PRESS : EVENT_LONG_PRESS;
+  unsigned long clicks = sim.truth.gesture == INTENDED_DOUBLE ? 2 : 1;
+  unsigned long gestureEvents = count.events[EVENT_SINGLE_PRESS] + count.events[EVENT_DOUBLE_PRESS] +
+                                count.events[EVENT_LONG_PRESS];
+
+  stats.gestures++;
+  stats.clicks += clicks;
+  if (count.events[EVENT_CHANGE] > clicks * 2) {
+    stats.falseEdges += count.events[EVENT_CHANGE] - clicks * 2;
+  }
+  if (!insideWindow(sim.truth)) {
+    // Not a debounce error: the library is configured to reject this timing
+    stats.outside++;
+    memset(&count, 0, sizeof(count));
+    return;
+  }
+  if (count.events[expected] == 0) {
+    stats.missed++;
+  } else {
+    if (gestureEvents == 1) {
+      stats.correct++;
+    }
+    double latencyMs = (double)count.firstDetectMs[expected] - sim.truth.completeUs / 1000.0;
+    stats.latencySumMs += latencyMs;
+    stats.latencyMaxMs = std::max(stats.latencyMaxMs, latencyMs);
+    stats.latencyCount++;
+  }
+  stats.falseEvents += gestureEvents - (count.events[expected] > 0 ? 1 : 0);
+  memset(&count, 0, sizeof(count));
+}
+
+// Run the given number of gestures of one pin through its own pin manager
+static void simulatePin(PinSim& sim, int pin, unsigned long gestures, unsigned long debounceMs) {
+  hostSetPin(pin, HIGH);
+  AvantDigitalRead pinManager;
+  pinManager.addPin(pin, INPUT_PULLUP);
+  pinManager.setDebounceTime(pin, debounceMs);
+  pinManager.setClickParameters(pin, window.minPressMs, window.maxPressMs);
+  pinManager.onChange(pin, countEvent);
+  pinManager.onSinglePress(pin, countEvent);
+  pinManager.onDoublePress(pin, countEvent, 0, window.maxIntervalMs);
+  pinManager.onLongPress(pin, countEvent, 0, window.pressDurationMs);
+
+  CheckQueue& windowChecks = sim.windowChecks;
+  uint8_t level = HIGH;         // Level after the last generated edge
+  uint8_t fedLevel = HIGH;      // Level the library has seen last
+  unsigned long fedMs = 0;      // Time of the last edge passed to the library
+  bool done = false;
+  while (true) {
+    uint64_t edgeUs = done ? UINT64_MAX : sim.generator.peekTimeUs();
+
+    // Windows expire on a millisecond boundary, before any edge in that millisecond
+    if (!windowChecks.empty() && windowChecks.top() <= edgeUs) {
+      unsigned long timeMs = (unsigned long)(windowChecks.top() / 1000);
+      while (!windowChecks.empty() && windowChecks.top() / 1000 == timeMs) {
+        windowChecks.pop();
+      }
+      pinManager.processSample((uint32_t)fedLevel << pin, timeMs);
+      continue;
+    }
+    if (done) {
+      break;
+    }
+
+    // All edges in this millisecond
+    unsigned long timeMs = (unsigned long)(edgeUs / 1000);
+    bool moved = false;
+    do {
+      const GestureTruth& truth = sim.generator.truth();
+      if (sim.generator.peekTimeUs() >= truth.startUs && (!sim.hasTruth || truth.startUs != sim.truth.startUs)) {
+        // First press edge of a new gesture: score the previous one
+        finishGesture(sim);
+        if (sim.stats.gestures == gestures) {
+          done = true;
+          break;
+        }
+        sim.truth = truth;
+        sim.hasTruth = true;
+      }
+      level = sim.generator.nextEdge().level;
+      moved = true;
+    } while (sim.generator.peekTimeUs() / 1000 == timeMs);
+    if (!moved) {
+      continue;
+    }
+
+    // Inside a burst the library cannot accept a level until the debounce time has passed since
+    // the last edge it saw, so an edge followed by another one within that time is left out
+    uint64_t nextUs = done ? UINT64_MAX : sim.generator.peekTimeUs();
+    if (nextUs / 1000 <= fedMs + debounceMs) {
+      continue;
+    }
+    pinManager.processSample((uint32_t)!fedLevel << pin, timeMs);
+    if (level == fedLevel) {
+      // Back at the level the library saw last: it still has to see the bounce
+      pinManager.processSample((uint32_t)level << pin, timeMs);
+    }
+    fedLevel = level;
+    fedMs = timeMs;
+
+    // A later edge restarts the debounce window, so it only needs a pass if it comes first
+    uint64_t acceptUs = (uint64_t)(timeMs + debounceMs + 1) * 1000;
+    if (nextUs >= acceptUs) {
+      windowChecks.push(acceptUs);
+    }
+  }
+  finishGesture(sim);
+}
+
+// Split "a,b,c" into items
+static std::vector<std::string> split(const char* text, char separator) {
+  std::vector<std::string> items;
+  std::string item;
+  for (const char* p = text; ; p++) {
+    if (*p == separator || *p == '\0') {
+      if (!item.empty()) {
+        items.push_back(item);
+      }
+      item.clear();
+      if (*p == '\0') {
+        break;
+      }
+    } else {
+      item.push_back(*p);
+    }
+  }
+  return items;
+}
+
+int main(int argc, char** argv) {
+  unsigned long gesturesPerPin = 20000;
+  uint64_t seed = 1;
+  std::vector<unsigned long> debounceTimes = {5, 10, 20, 50};
+  std::vector<std::pair<unsigned long, unsigned long> > clickParameters = {{50, 300}, {30, 400}};
+  unsigned long maxIntervalMs = DEFAULT_MAX_INTERVAL_MS;
+  unsigned long pressDurationMs = DEFAULT_PRESS_DURATION_MS;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "--gestures") {
+      gesturesPerPin = strtoul(argv[i + 1], nullptr, 10);
+    } else if (arg == "--seed") {
+      seed = strtoull(argv[i + 1], nullptr, 10);
+    } else if (arg == "--debounce") {
+      debounceTimes.clear();
+      for (auto& item : split(argv[i + 1], ',')) {
+        debounceTimes.push_back(strtoul(item.c_str(), nullptr, 10));
+      }
+    } else if (arg == "--click") {
+      clickParameters.clear();
+      for (auto& item : split(argv[i + 1], ',')) {
+        std::vector<std::string> parts = split(item.c_str(), ':');
+        if (parts.size() == 2) {
+          clickParameters.push_back(std::make_pair(strtoul(parts[0].c_str(), nullptr, 10),
+                                                   strtoul(parts[1].c_str(), nullptr, 10)));
+        }
+      }
+    } else if (arg == "--interval") {
+      maxIntervalMs = strtoul(argv[i + 1], nullptr, 10);
+    } else if (arg == "--long-press") {
+      pressDurationMs = strtoul(argv[i + 1], nullptr, 10);
+    } else {
+      fprintf(stderr, "Unknown option %s\n", arg.c_str());
+      return 1;
+    }
+  }
+
+  const BounceProfile* profiles[] = {
+    &BOUNCE_PROFILE_CLEAN, &BOUNCE_PROFILE_MECHANICAL, &BOUNCE_PROFILE_REED, &BOUNCE_PROFILE_NOISY_CABLE
+  };
+  const int pinCount = sizeof(profiles) / sizeof(profiles[0]);
+
+  printf("seed=%llu gestures/pin=%lu maxInterval=%lu longPress=%lu\n",
+         (unsigned long long)seed, gesturesPerPin, maxIntervalMs, pressDurationMs);
+
+  for (unsigned long debounceMs : debounceTimes) {
+    for (auto& click : clickParameters) {
+      // Same seed for every configuration: all of them see identical waveforms
+      hostUseSimulatedClock();
+      std::vector<PinSim> pinSims;
+      for (int pin = 0; pin < pinCount; pin++) {
+        PinSim sim = {AvantBounceGenerator(seed * 1000003ULL + pin, *profiles[pin], HIGH, (float)pressDurationMs),
+                      profiles[pin], GestureTruth(), false, GestureCount(), ProfileStats(), CheckQueue()};
+        memset(&sim.count, 0, sizeof(sim.count));
+        memset(&sim.stats, 0, sizeof(sim.stats));
+        pinSims.push_back(sim);
+      }
+      sims = &pinSims;
+      window = {click.first, click.second, maxIntervalMs, pressDurationMs};
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      // The pins share nothing but the read-only settings, so each runs in its own thread
+      std::vector<std::thread> threads;
+      for (int pin = 0; pin < pinCount; pin++) {
+        threads.emplace_back(simulatePin, std::ref(pinSims[pin]), pin, gesturesPerPin, debounceMs);
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      unsigned long totalClicks = 0;
+      printf("\ndebounce=%lu click=%lu:%lu\n", debounceMs, click.first, click.second);
+      printf("  %-12s %9s %9s %9s %9s %9s %11s %12s %12s\n", "profile", "gestures", "outside", "correct",
+             "missed", "false", "falseEdges", "latAvg(ms)", "latMax(ms)");
+      for (auto& s : pinSims) {
+        ProfileStats& stats = s.stats;
+        totalClicks += stats.clicks;
+        printf("  %-12s %9lu %9lu %9lu %9lu %9lu %11lu %12.1f %12.1f\n", s.profile->name, stats.gestures,
+               stats.outside, stats.correct, stats.missed, stats.falseEvents, stats.falseEdges,
+               stats.latencyCount ? stats.latencySumMs / stats.latencyCount : 0.0, stats.latencyMaxMs);
+      }
+      double pressesPerSecond = totalClicks / seconds;
+      printf("  %.0f simulated presses/s (target %.0f: %s)\n", pressesPerSecond, TARGET_PRESSES_PER_SECOND,
+             pressesPerSecond >= TARGET_PRESSES_PER_SECOND ? "met" : "not met");
+      sims = nullptr;
+    }
+  }
+  return 0;
+}
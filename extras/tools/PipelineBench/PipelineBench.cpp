@@ -0,0 +1,119 @@
+/*
+ * PipelineBench
+ *
+ * Description:
+ * Host benchmark for the two-stage sampling/dispatch pipeline. A producer thread
+ * toggles simulated pins and runs the sampling stage (sample()), while a consumer
+ * thread runs the dispatch stage (dispatch()), so events cross the lock-free
+ * event queue exactly as they do between the two ESP32 tasks started by
+ * startPipeline(). A second phase runs startPipeline() itself on the real clock.
+ *
+ * Build (from the repository root):
+ *   g++ -std=c++17 -O2 -pthread -Iextras/host -Isrc \
+ *       extras/tools/PipelineBench/PipelineBench.cpp src/AvantDigitalRead.cpp -o PipelineBench
+ *
+ * Usage:
+ *   ./PipelineBench [pins] [toggles]
+ */
+
+#include <Arduino.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "AvantDigitalRead.h"
+
+static std::atomic<unsigned long> callbackCount(0);
+
+// Count every delivered event
+void countCallback(int pin, PinState newState, PinState oldState,
+                   EventType event, unsigned long timestamp) {
+  (void)pin;
+  (void)newState;
+  (void)oldState;
+  (void)event;
+  (void)timestamp;
+  callbackCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+int main(int argc, char** argv) {
+  int pinCount = argc > 1 ? atoi(argv[1]) : 16;
+  unsigned long toggles = argc > 2 ? strtoul(argv[2], nullptr, 10) : 200000;
+
+  // Phase 1: simulated clock, stages driven by two threads as fast as possible
+  hostUseSimulatedClock();
+  AvantDigitalRead pinManager;
+  for (int pin = 0; pin < pinCount; pin++) {
+    pinManager.addPin(pin, INPUT_PULLUP);
+    pinManager.setDebounceTime(pin, 0);
+    pinManager.onChange(pin, countCallback);
+  }
+
+  std::atomic<bool> producing(true);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  std::thread consumer([&]() {
+    while (producing.load(std::memory_order_acquire)) {
+      pinManager.dispatch();
+      if (pinManager.getQueuedEvents() == 0) {
+        std::this_thread::yield();
+      }
+    }
+    pinManager.dispatch();
+  });
+
+  std::thread producer([&]() {
+    for (unsigned long i = 0; i < toggles; i++) {
+      // Let the consumer catch up instead of measuring queue overflow
+      while (pinManager.getQueuedEvents() + pinCount >= AVANT_EVENT_QUEUE_SIZE) {
+        std::this_thread::yield();
+      }
+      int level = (i & 1) ? HIGH : LOW;
+      for (int pin = 0; pin < pinCount; pin++) {
+        hostSetPin(pin, level);
+      }
+      // One pass sees the edge, the next one accepts it (debounce time 0)
+      hostAdvanceMicros(1000);
+      pinManager.sample();
+      hostAdvanceMicros(1000);
+      pinManager.sample();
+    }
+    producing.store(false, std::memory_order_release);
+  });
+
+  producer.join();
+  consumer.join();
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  unsigned long expected = toggles * (unsigned long)pinCount;
+  unsigned long delivered = callbackCount.load();
+  printf("Simulated clock: %d pins, %lu toggles\n", pinCount, toggles);
+  printf("  events expected:  %lu\n", expected);
+  printf("  events delivered: %lu\n", delivered);
+  printf("  events dropped:   %lu\n", pinManager.getDroppedEvents());
+  printf("  throughput:       %.0f events/s (%.3f s)\n", delivered / seconds, seconds);
+
+  // Phase 2: real clock, stages running in the tasks created by startPipeline()
+  hostUseRealClock();
+  callbackCount.store(0);
+  AvantDigitalRead taskManager;
+  for (int pin = 0; pin < pinCount; pin++) {
+    taskManager.addPin(pin, INPUT_PULLUP);
+    taskManager.setDebounceTime(pin, 2);
+    taskManager.onChange(pin, countCallback);
+  }
+  taskManager.startPipeline(1);
+  const int realToggles = 100;
+  for (int i = 0; i < realToggles; i++) {
+    for (int pin = 0; pin < pinCount; pin++) {
+      hostSetPin(pin, (i & 1) ? HIGH : LOW);
+    }
+    delay(10);
+  }
+  delay(20);
+  taskManager.stopPipeline();
+  printf("Real clock with startPipeline(1): %d toggles x %d pins\n", realToggles, pinCount);
+  printf("  events expected:  %d\n", realToggles * pinCount);
+  printf("  events delivered: %lu, dropped: %lu\n", callbackCount.load(), taskManager.getDroppedEvents());
+  return 0;
+}
@@ -0,0 +1,458 @@
+/*
+ * VcdTune
+ *
+ * Description:
+ * Host tool that streams a VCD (Value Change Dump) capture, e.g. from a logic
+ * analyzer, through the AvantDigitalRead debounce and gesture engine and writes
+ * a VCD of the debounced states plus event markers. It makes tuning debounceTime,
+ * minPressMs, maxPressMs, maxIntervalMs and pressDurationMs a repeatable desktop
+ * run instead of a flash-and-press cycle.
+ *
+ * The input is read token by token through a fixed buffer and nothing is kept per
+ * value change, so captures of any size run in constant memory. Timing inside the
+ * library has millisecond resolution: the output uses a 1 ms timescale.
+ *
+ * Build (from the repository root):
+ *   g++ -std=c++17 -O2 -pthread -Iextras/host -Isrc \
+ *       extras/tools/VcdTune/VcdTune.cpp src/AvantDigitalRead.cpp src/AvantChromeTrace.cpp -o VcdTune
+ *
+ * Add -DAVANT_TRACE_LEVEL=3 for --trace to record edges, debounce windows and
+ * click state as well as events and callbacks.
+ *
+ * Usage:
+ *   ./VcdTune input.vcd output.vcd [options]
+ *
+ * Options:
+ *   --map NAME=PIN     Feed the 1-bit signal NAME (or scope.NAME) into pin PIN (0-31). Repeatable.
+ *                      Without --map, the first 32 1-bit signals map to pins 0, 1, 2, ...
+ *   --debounce MS      setDebounceTime() for every pin (default 50)
+ *   --min-press MS     setClickParameters() minPressMs (default 50)
+ *   --max-press MS     setClickParameters() maxPressMs (default 300)
+ *   --max-interval MS  onDoublePress() maxIntervalMs (default 300)
+ *   --long-press MS    onLongPress() pressDurationMs (default 1000)
+ *   --repeat           Repeat long press events while held
+ *   --idle-low         Signals idle LOW (default: HIGH, as with INPUT_PULLUP buttons)
+ *   --trace FILE       Also write a Chrome Trace Event JSON timeline (chrome://tracing, Perfetto)
+ */
+
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "AvantDigitalRead.h"
+#include "AvantChromeTrace.h"
+
+// Buffered whitespace tokenizer over a FILE*
+class TokenReader {
+public:
+  explicit TokenReader(FILE* file) : file(file), length(0), position(0) {}
+
+  // Read the next token, returns false at end of file
+  bool next(std::string& token) {
+    token.clear();
+    int c;
+    do {
+      c = get();
+    } while (c == ' ' || c == '\t' || c == '\r' || c == '\n');
+    if (c == EOF) {
+      return false;
+    }
+    while (c != EOF && c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+      if (token.size() < MAX_TOKEN_LENGTH) {
+        token.push_back((char)c);
+      }
+      c = get();
+    }
+    return true;
+  }
+
+  // Skip tokens up to and including $end
+  void skipToEnd() {
+    std::string token;
+    while (next(token) && token != "$end") {
+    }
+  }
+
+private:
+  static const size_t BUFFER_SIZE = 1 << 16;
+  static const size_t MAX_TOKEN_LENGTH = 4096;
+
+  int get() {
+    if (position == length) {
+      length = fread(buffer, 1, BUFFER_SIZE, file);
+      position = 0;
+      if (length == 0) {
+        return EOF;
+      }
+    }
+    return buffer[position++];
+  }
+
+  FILE* file;
+  unsigned char buffer[BUFFER_SIZE];
+  size_t length;
+  size_t position;
+};
+
+// Signal of the input file fed into a pin
+struct Signal {
+  std::string id;
+  std::string name;
+  std::string fullName;  // Name with its scope path, e.g. top.panel.btn
+  int pin;
+};
+
+// Output state shared with the callbacks
+static FILE* output = nullptr;
+static unsigned long outputTime = 0;
+static bool outputTimeWritten = false;
+static std::vector<int> markerPending;  // Pins whose event marker must return to 0
+static unsigned long eventCounts[32][8];
+static const char* const EVENT_NAMES[] = {
+  "change", "rising", "falling", "single", "double", "long"
+};
+
+// Pins use identifiers "s<pin>" (state) and "e<pin>" (event) in the output
+static void writeTime(unsigned long timestamp) {
+  if (!outputTimeWritten || timestamp != outputTime) {
+    // Clear the event markers raised at the previous timestamp
+    if (!markerPending.empty()) {
+      fprintf(output, "#%lu\n", outputTime + 1);
+      for (int pin : markerPending) {
+        fprintf(output, "b0 e%d\n", pin);
+      }
+      markerPending.clear();
+    }
+    if (!outputTimeWritten || timestamp > outputTime + 1) {
+      fprintf(output, "#%lu\n", timestamp);
+    }
+    outputTime = timestamp;
+    outputTimeWritten = true;
+  }
+}
+
+// Record every library event in the output VCD
+void recordEvent(int pin, PinState newState, PinState oldState,
+                 EventType event, unsigned long timestamp) {
+  (void)oldState;
+  if (pin < 0 || pin >= 32) {
+    return;
+  }
+  eventCounts[pin][event]++;
+  writeTime(timestamp);
+  if (event == EVENT_CHANGE) {
+    fprintf(output, "%ds%d\n", newState == PIN_HIGH ? 1 : 0, pin);
+    return;
+  }
+  // Event marker: EventType + 1 for one millisecond
+  unsigned code = (unsigned)event + 1;
+  char bits[9];
+  int n = 0;
+  for (int bit = 3; bit >= 0; bit--) {
+    bits[n++] = (code >> bit) & 1 ? '1' : '0';
+  }
+  bits[n] = '\0';
+  fprintf(output, "b%s e%d\n", bits, pin);
+  markerPending.push_back(pin);
+}
+
+// Convert a VCD timescale ("1ns", "10 us", ...) into a multiplier/divisor to milliseconds
+static bool parseTimescale(const std::string& text, uint64_t& mult, uint64_t& div) {
+  char* unit = nullptr;
+  unsigned long magnitude = strtoul(text.c_str(), &unit, 10);
+  if (magnitude == 0) {
+    return false;
+  }
+  std::string u(unit);
+  mult = magnitude;
+  div = 1;
+  if (u == "s") {
+    mult *= 1000;
+  } else if (u == "ms") {
+  } else if (u == "us") {
+    div = 1000ULL;
+  } else if (u == "ns") {
+    div = 1000000ULL;
+  } else if (u == "ps") {
+    div = 1000000000ULL;
+  } else if (u == "fs") {
+    div = 1000000000000ULL;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "Usage: %s input.vcd output.vcd [--map NAME=PIN] [--debounce MS] [--min-press MS]\n"
+                    "       [--max-press MS] [--max-interval MS] [--long-press MS] [--repeat] [--idle-low]\n"
+                    "       [--trace FILE]\n", argv[0]);
+    return 1;
+  }
+
+  unsigned long debounceMs = DEFAULT_DEBOUNCE_TIME;
+  unsigned long minPressMs = DEFAULT_MIN_PRESS_MS;
+  unsigned long maxPressMs = DEFAULT_MAX_PRESS_MS;
+  unsigned long maxIntervalMs = DEFAULT_MAX_INTERVAL_MS;
+  unsigned long pressDurationMs = DEFAULT_PRESS_DURATION_MS;
+  bool repeat = false;
+  bool idleLow = false;
+  const char* tracePath = nullptr;
+  std::vector<std::pair<std::string, int> > mapping;
+
+  for (int i = 3; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--map" && hasValue) {
+      std::string spec = argv[++i];
+      size_t eq = spec.find('=');
+      if (eq == std::string::npos) {
+        fprintf(stderr, "Invalid --map %s\n", spec.c_str());
+        return 1;
+      }
+      mapping.push_back(std::make_pair(spec.substr(0, eq), atoi(spec.c_str() + eq + 1)));
+    } else if (arg == "--debounce" && hasValue) {
+      debounceMs = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--min-press" && hasValue) {
+      minPressMs = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--max-press" && hasValue) {
+      maxPressMs = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--max-interval" && hasValue) {
+      maxIntervalMs = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--long-press" && hasValue) {
+      pressDurationMs = strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--repeat") {
+      repeat = true;
+    } else if (arg == "--idle-low") {
+      idleLow = true;
+    } else if (arg == "--trace" && hasValue) {
+      tracePath = argv[++i];
+    } else {
+      fprintf(stderr, "Unknown option %s\n", arg.c_str());
+      return 1;
+    }
+  }
+  if (debounceMs > MAX_PIN_TIMING_MS || minPressMs > MAX_PIN_TIMING_MS || maxPressMs > MAX_PIN_TIMING_MS ||
+      maxIntervalMs > MAX_PIN_TIMING_MS || pressDurationMs > MAX_PIN_TIMING_MS) {
+    fprintf(stderr, "Timing values are limited to %lu ms\n", MAX_PIN_TIMING_MS);
+    return 1;
+  }
+
+  FILE* input = fopen(argv[1], "rb");
+  if (input == nullptr) {
+    fprintf(stderr, "Cannot open %s\n", argv[1]);
+    return 1;
+  }
+  output = fopen(argv[2], "wb");
+  if (output == nullptr) {
+    fprintf(stderr, "Cannot create %s\n", argv[2]);
+    return 1;
+  }
+  FILE* traceFile = nullptr;
+  if (tracePath != nullptr) {
+    traceFile = fopen(tracePath, "wb");
+    if (traceFile == nullptr) {
+      fprintf(stderr, "Cannot create %s\n", tracePath);
+      return 1;
+    }
+    if (AVANT_TRACE_LEVEL == 0) {
+      fprintf(stderr, "Built without AVANT_TRACE_LEVEL: %s will hold no records\n", tracePath);
+    }
+  }
+  HostFilePrint tracePrint(traceFile != nullptr ? traceFile : stderr);
+  AvantChromeTrace traceWriter(tracePrint);
+
+  // Header: timescale and 1-bit signal declarations
+  TokenReader reader(input);
+  std::string token;
+  uint64_t timeMult = 1;
+  uint64_t timeDiv = 1000000ULL;  // VCD default timescale is 1 ns
+  std::vector<Signal> signals;
+  std::string scope;
+  while (reader.next(token) && token != "$enddefinitions") {
+    if (token == "$timescale") {
+      std::string text;
+      while (reader.next(token) && token != "$end") {
+        text += token;
+      }
+      if (!parseTimescale(text, timeMult, timeDiv)) {
+        fprintf(stderr, "Unsupported timescale %s\n", text.c_str());
+        return 1;
+      }
+    } else if (token == "$scope") {
+      std::string type, name;
+      reader.next(type);
+      reader.next(name);
+      scope = scope.empty() ? name : scope + "." + name;
+      reader.skipToEnd();
+    } else if (token == "$upscope") {
+      size_t dot = scope.rfind('.');
+      scope = dot == std::string::npos ? std::string() : scope.substr(0, dot);
+      reader.skipToEnd();
+    } else if (token == "$var") {
+      std::string type, width, id, name;
+      reader.next(type);
+      reader.next(width);
+      reader.next(id);
+      reader.next(name);
+      reader.skipToEnd();
+      if (width == "1") {
+        Signal signal;
+        signal.id = id;
+        signal.name = name;
+        signal.fullName = scope.empty() ? name : scope + "." + name;
+        signal.pin = -1;
+        signals.push_back(signal);
+      }
+    } else if (token[0] == '$') {
+      reader.skipToEnd();
+    }
+  }
+
+  // Assign pins
+  if (mapping.empty()) {
+    for (size_t i = 0; i < signals.size() && i < 32; i++) {
+      signals[i].pin = (int)i;
+    }
+  } else {
+    for (auto& entry : mapping) {
+      for (auto& signal : signals) {
+        bool matches = signal.name == entry.first || signal.fullName == entry.first;
+        if (matches && entry.second >= 0 && entry.second < 32) {
+          signal.pin = entry.second;
+        }
+      }
+    }
+  }
+
+  // Engine setup: every mapped pin gets every callback
+  hostUseSimulatedClock();
+  AvantDigitalRead pinManager;
+  uint32_t word = 0;
+  int idleLevel = idleLow ? LOW : HIGH;
+  fprintf(output, "$timescale 1 ms $end\n$scope module AvantDigitalRead $end\n");
+  for (auto& signal : signals) {
+    if (signal.pin < 0 || pinManager.isInitialized(signal.pin)) {
+      continue;
+    }
+    hostSetPin(signal.pin, idleLevel);
+    pinManager.addPin(signal.pin, INPUT);
+    pinManager.setDebounceTime(signal.pin, debounceMs);
+    pinManager.setClickParameters(signal.pin, minPressMs, maxPressMs);
+    pinManager.onChange(signal.pin, recordEvent);
+    pinManager.onRising(signal.pin, recordEvent);
+    pinManager.onFalling(signal.pin, recordEvent);
+    pinManager.onSinglePress(signal.pin, recordEvent);
+    pinManager.onDoublePress(signal.pin, recordEvent, 0, maxIntervalMs);
+    pinManager.onLongPress(signal.pin, recordEvent, 0, pressDurationMs, repeat);
+    if (idleLevel == HIGH) {
+      word |= 1u << signal.pin;
+    }
+    fprintf(output, "$var wire 1 s%d %s_debounced $end\n", signal.pin, signal.name.c_str());
+    fprintf(output, "$var wire 4 e%d %s_event $end\n", signal.pin, signal.name.c_str());
+  }
+  fprintf(output, "$upscope $end\n$enddefinitions $end\n");
+  fprintf(output, "$comment event codes: 2=rising 3=falling 4=single 5=double 6=long $end\n");
+
+  // Initial values: every pin starts at its idle level with no event
+  fprintf(output, "#0\n$dumpvars\n");
+  for (auto& signal : signals) {
+    if (signal.pin >= 0) {
+      fprintf(output, "%ds%d\nb0 e%d\n", idleLevel, signal.pin, signal.pin);
+    }
+  }
+  fprintf(output, "$end\n");
+  outputTimeWritten = true;
+
+  // Run one snapshot with the clock at its time, streaming the trace records it produced
+  if (traceFile != nullptr) {
+    traceWriter.begin();
+  }
+  auto feed = [&](unsigned long timeMs) {
+    hostSetMicros((uint64_t)timeMs * 1000);
+    pinManager.processSample(word, timeMs);
+    if (traceFile != nullptr) {
+      traceWriter.write(pinManager);
+    }
+  };
+
+  // Map identifier -> pin; signal lists are short, a linear search is fine
+  auto pinOf = [&](const std::string& id) -> int {
+    for (auto& signal : signals) {
+      if (signal.id == id) {
+        return signal.pin;
+      }
+    }
+    return -1;
+  };
+
+  // Body: feed every value change and every millisecond in between
+  bool started = false;
+  unsigned long currentMs = 0;
+  unsigned long long valueChanges = 0;
+  while (reader.next(token)) {
+    char kind = token[0];
+    if (kind == '#') {
+      unsigned long long raw = strtoull(token.c_str() + 1, nullptr, 10);
+      unsigned long timeMs = (unsigned long)(((unsigned __int128)raw * timeMult) / timeDiv);
+      if (!started) {
+        pinManager.setSampleClock(timeMs);
+        feed(timeMs);
+        started = true;
+      } else {
+        // Let timeouts (long press, single press window, delays) run at their own time
+        for (unsigned long ms = currentMs + 1; ms < timeMs; ms++) {
+          feed(ms);
+        }
+      }
+      currentMs = timeMs;
+    } else if (kind == '0' || kind == '1' || kind == 'x' || kind == 'X' || kind == 'z' || kind == 'Z') {
+      int pin = pinOf(token.substr(1));
+      if (pin >= 0 && (kind == '0' || kind == '1')) {
+        if (kind == '1') {
+          word |= 1u << pin;
+        } else {
+          word &= ~(1u << pin);
+        }
+        feed(currentMs);
+        valueChanges++;
+      }
+    } else if (kind == 'b' || kind == 'B' || kind == 'r' || kind == 'R') {
+      // Vector and real values: skip the identifier that follows
+      reader.next(token);
+    } else if (token == "$comment") {
+      reader.skipToEnd();
+    }
+  }
+
+  // Let pending timeouts expire after the last change
+  for (unsigned long ms = currentMs + 1; ms <= currentMs + pressDurationMs + maxIntervalMs + 1; ms++) {
+    feed(ms);
+  }
+  writeTime(currentMs + pressDurationMs + maxIntervalMs + 2);
+
+  fclose(input);
+  fclose(output);
+  if (traceFile != nullptr) {
+    traceWriter.end();
+    fclose(traceFile);
+  }
+
+  // Summary for quick comparison between parameter sets
+  printf("debounce=%lu minPress=%lu maxPress=%lu maxInterval=%lu longPress=%lu%s\n",
+         debounceMs, minPressMs, maxPressMs, maxIntervalMs, pressDurationMs, repeat ? " repeat" : "");
+  printf("%llu value changes processed\n", valueChanges);
+  for (auto& signal : signals) {
+    if (signal.pin < 0) {
+      continue;
+    }
+    printf("pin %2d %-20s", signal.pin, signal.name.c_str());
+    for (int event = 0; event <= EVENT_LONG_PRESS; event++) {
+      printf(" %s=%lu", EVENT_NAMES[event], eventCounts[signal.pin][event]);
+    }
+    printf("\n");
+  }
+  return 0;
+}
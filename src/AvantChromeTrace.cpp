@@ -0,0 +1,173 @@
+#include "AvantChromeTrace.h"
+#include <string.h>
+
+// Names used in the trace, indexed by EventType
+static const char* const EVENT_NAMES[] = {
+  "CHANGE", "RISING", "FALLING", "SINGLE_PRESS", "DOUBLE_PRESS", "LONG_PRESS", "SINGLE_PRESS_RETRACT", "TIMER", "ENCODER",
+  "PULSE_REPORT"
+};
+
+AvantChromeTrace::AvantChromeTrace(Print& out)
+  : out(out), firstEvent(true), lastTimeUs(0), clockUs(0), clockStarted(false) {
+  memset(namedTracks, 0, sizeof(namedTracks));
+}
+
+// Start the JSON document
+void AvantChromeTrace::begin() {
+  out.print("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  out.print("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"AvantDigitalRead\"}}");
+  firstEvent = false;
+}
+
+// Convert the unread trace records, returns how many
+size_t AvantChromeTrace::write(AvantDigitalRead& pinManager) {
+  TraceRecord records[8];
+  size_t total = 0;
+  size_t count;
+  while ((count = pinManager.readTrace(records, 8)) != 0) {
+    for (size_t i = 0; i < count; i++) {
+      writeRecord(records[i]);
+    }
+    total += count;
+  }
+  return total;
+}
+
+// Close the JSON document
+void AvantChromeTrace::end() {
+  out.print("\n]}\n");
+}
+
+// Extend a 32-bit micros() time to 64 bits using the last time seen
+uint64_t AvantChromeTrace::unwrap(uint32_t timeUs) {
+  if (!clockStarted) {
+    clockUs = timeUs;
+    clockStarted = true;
+  } else {
+    // Records are close in time: a signed difference also handles ones slightly out of order
+    clockUs += (int64_t)(int32_t)(timeUs - lastTimeUs);
+  }
+  lastTimeUs = timeUs;
+  return clockUs;
+}
+
+// Name the track of a pin the first time it appears
+void AvantChromeTrace::nameTrack(uint8_t pin) {
+  if (namedTracks[pin >> 5] & (1UL << (pin & 31))) {
+    return;
+  }
+  namedTracks[pin >> 5] |= 1UL << (pin & 31);
+  out.print(firstEvent ? "" : ",\n");
+  firstEvent = false;
+  out.print("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":");
+  out.print((unsigned)pin);
+  if (pin == 255) {
+    out.print(",\"args\":{\"name\":\"no pin\"}}");
+  } else {
+    out.print(",\"args\":{\"name\":\"pin ");
+    out.print((unsigned)pin);
+    out.print("\"}}");
+  }
+}
+
+// Write the fields shared by all events, up to and including "ts"
+void AvantChromeTrace::startEvent(const char* name, const char* suffix, const char* phase,
+                                  uint8_t pin, uint64_t timeUs) {
+  nameTrack(pin);
+  out.print(firstEvent ? "" : ",\n");
+  firstEvent = false;
+  out.print("{\"name\":\"");
+  out.print(name);
+  out.print(suffix);
+  out.print("\",\"ph\":\"");
+  out.print(phase);
+  out.print("\",\"pid\":1,\"tid\":");
+  out.print((unsigned)pin);
+  out.print(",\"ts\":");
+  out.print((unsigned long long)timeUs);
+}
+
+// Convert one record
+void AvantChromeTrace::writeRecord(const TraceRecord& record) {
+  if (record.event > EVENT_PULSE_REPORT) {
+    return;
+  }
+  const char* eventName = EVENT_NAMES[record.event];
+  uint64_t recordTime = unwrap(record.timeUs);
+  uint64_t eventTime = recordTime + (int64_t)(int32_t)(record.eventTimeUs - record.timeUs);
+
+  switch (record.id) {
+    case TRACE_CALLBACK:
+      // Callback span
+      startEvent(eventName, " callback", "X", record.pin, eventTime);
+      out.print(",\"dur\":");
+      out.print((unsigned long)record.value);
+      out.print("}");
+      break;
+
+    case TRACE_DEBOUNCED:
+      // Debounce window from the first raw edge to acceptance, then the new level
+      startEvent("debounce ", eventName, "X", record.pin, eventTime - record.value);
+      out.print(",\"dur\":");
+      out.print((unsigned long)record.value);
+      out.print("}");
+      startEvent("level", "", "C", record.pin, eventTime);
+      out.print(",\"args\":{\"pin ");
+      out.print((unsigned)record.pin);
+      out.print(record.event == EVENT_RISING ? "\":1}}" : "\":0}}");
+      break;
+
+    case TRACE_RAW_EDGE:
+      startEvent("raw ", eventName, "i", record.pin, eventTime);
+      out.print(",\"s\":\"t\"}");
+      break;
+
+    case TRACE_CLICK_STATE:
+      startEvent("clicks", "", "C", record.pin, eventTime);
+      out.print(",\"args\":{\"pin ");
+      out.print((unsigned)record.pin);
+      out.print("\":");
+      out.print((unsigned long)record.value);
+      out.print("}}");
+      break;
+
+    case TRACE_EVENT:
+      startEvent(eventName, "", "i", record.pin, recordTime);
+      out.print(",\"s\":\"t\",\"args\":{\"edge_us\":");
+      out.print((unsigned long long)eventTime);
+      out.print(",\"delay_ms\":");
+      out.print((unsigned long)record.value);
+      out.print("}}");
+      break;
+
+    case TRACE_EVENT_DROPPED:
+      startEvent("dropped ", eventName, "i", record.pin, recordTime);
+      out.print(",\"s\":\"t\"}");
+      break;
+
+    case TRACE_SLOW_CALLBACK:
+      startEvent("slow ", eventName, "i", record.pin, recordTime);
+      out.print(",\"s\":\"t\",\"args\":{\"run_us\":");
+      out.print((unsigned long)record.value);
+      out.print("}}");
+      break;
+
+    case TRACE_DELAYED_ADDED:
+    case TRACE_DELAYED_REPLACED:
+    case TRACE_DELAYED_CANCELLED:
+      startEvent(record.id == TRACE_DELAYED_ADDED ? "delay " :
+                 record.id == TRACE_DELAYED_REPLACED ? "redelay " : "cancel ",
+                 eventName, "i", record.pin, recordTime);
+      out.print(",\"s\":\"t\",\"args\":{\"due_us\":");
+      out.print((unsigned long long)eventTime);
+      out.print("}}");
+      break;
+
+    case TRACE_DELAYED_RUN:
+      startEvent("delayed ", eventName, "i", record.pin, recordTime);
+      out.print(",\"s\":\"t\",\"args\":{\"late_ms\":");
+      out.print((unsigned long)record.value);
+      out.print("}}");
+      break;
+  }
+}
@@ -0,0 +1,43 @@
+#ifndef AVANTCHROMETRACE_H
+#define AVANTCHROMETRACE_H
+
+#include <Arduino.h>
+#include "AvantDigitalRead.h"
+
+// Streams the trace records of an AvantDigitalRead as Chrome Trace Event JSON,
+// loadable in chrome://tracing and Perfetto. Each pin gets its own track with
+// callback spans, debounce windows, raw edges, events and counters for the
+// debounced level and click state.
+//
+// Records are converted as they are read from the trace ring buffer, so call
+// write() often enough that the buffer does not overwrite unread records; the
+// capture itself never has to fit in memory. Output goes to any Print (Serial,
+// a file, a network client; HostFilePrint in host builds).
+class AvantChromeTrace {
+public:
+  explicit AvantChromeTrace(Print& out);
+
+  void begin();                                // Start the JSON document
+  size_t write(AvantDigitalRead& pinManager);  // Convert the unread records, returns how many
+  void writeRecord(const TraceRecord& record); // Convert one record
+  void end();                                  // Close the JSON document
+
+private:
+  Print& out;
+  bool firstEvent;          // No event written yet (no comma before the next one)
+  uint32_t namedTracks[8];  // Pins whose track name has been written (bit per pin)
+  uint32_t lastTimeUs;      // Last 32-bit time seen, for unwrapping
+  uint64_t clockUs;         // Unwrapped time of lastTimeUs
+  bool clockStarted;
+
+  // Extend a 32-bit micros() time to 64 bits using the last time seen
+  uint64_t unwrap(uint32_t timeUs);
+
+  // Write the fields shared by all events, up to and including "ts"
+  void startEvent(const char* name, const char* suffix, const char* phase, uint8_t pin, uint64_t timeUs);
+
+  // Name the track of a pin the first time it appears
+  void nameTrack(uint8_t pin);
+};
+
+#endif // AVANTCHROMETRACE_H
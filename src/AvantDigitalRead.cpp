@@ -1,473 +1,3315 @@
 #include "AvantDigitalRead.h"
+#include <string.h>
+#include <algorithm>
 
-AvantDigitalRead::AvantDigitalRead() {
+// update() walks pinList on every pass; keep each entry within half a cache line
+static_assert(sizeof(PinInfo) <= 32, "PinInfo grew past 32 bytes");
+static_assert(EVENT_TYPE_COUNT <= 8, "PinInfo::subscribed holds one bit per event type");
+static_assert((AVANT_TRACE_BUFFER_SIZE & (AVANT_TRACE_BUFFER_SIZE - 1)) == 0,
+              "AVANT_TRACE_BUFFER_SIZE must be a power of two");
+
+// Trace ring buffer (oldest records are overwritten). Records are stored as atomic words
+// with a commit sequence per slot: 2 * index + 1 while record index is written, 2 * index + 2
+// once it is complete. A writer owns a slot from that odd value on, so records written by
+// several tasks never mix, and the reader skips records overwritten while it copied them.
+const int TRACE_RECORD_WORDS = sizeof(TraceRecord) / sizeof(uint32_t);
+static_assert(sizeof(TraceRecord) == TRACE_RECORD_WORDS * sizeof(uint32_t), "TraceRecord must be whole words");
+
+struct AvantTraceBuffer {
+  std::atomic<uint32_t> words[AVANT_TRACE_BUFFER_SIZE][TRACE_RECORD_WORDS];
+  std::atomic<uint32_t> sequence[AVANT_TRACE_BUFFER_SIZE];
+  std::atomic<uint32_t> head;              // Records claimed so far (any task)
+  uint32_t tail;                           // Records read so far (reader side)
+  unsigned long lost;                      // Records overwritten or dropped before they were read
+};
+
+// Callback latency histograms
+struct AvantLatencyTable {
+  uint8_t index[256];                      // Per pin number: index + 1 in stats (0 = not recorded)
+  std::vector<LatencyHistogram> stats;     // LATENCY_EVENT_TYPES histograms per recorded pin
+};
+
+// Record a trace point; compiled out above AVANT_TRACE_LEVEL
+#if AVANT_TRACE_LEVEL > 0
+#define AVANT_TRACE(level, id, pin, event, eventTimeUs, value) \
+  do { if ((level) <= AVANT_TRACE_LEVEL) trace((id), (pin), (event), (eventTimeUs), (value)); } while (0)
+#else
+#define AVANT_TRACE(level, id, pin, event, eventTimeUs, value) do { } while (0)
+#endif
+
+AvantDigitalRead::AvantDigitalRead()
+  : nextToken(1), changesPending(false), inPass(false), deferredReconfiguration(false),
+    levelsChanged(false), snapshotSequence(0), timeEpoch(0), pendingDelayed(0), nextDueSequence(0), readingTimeUs(0),
+    callbackBudgetUs(0), slowCallbackHook(nullptr), deferSlowCallbacks(false), queueEvents(false), droppedEvents(0), pipelineRunning(false),
+    dispatchRunning(false),
+    samplePeriodMs(DEFAULT_SAMPLE_PERIOD_MS), timerSampling(false), overrunSamples(0),
+    captureSequence(0), sampleIntervalUs(0), timerStartTime(0), timerStartUs(0),
+    expectedSequence(0), timerElapsedUs(0), sampleClockUs(0), sampleClockStarted(false),
+    lastSampleWord(0), lastSampleTime(0), traceBuffer(nullptr), latencyTable(nullptr) {
   // Constructor, initialize vector
+  // Profile 0 holds the default timing of every new pin
+  GestureProfile defaults;
+  defaults.debounceTime = DEFAULT_DEBOUNCE_TIME;
+  defaults.minPressMs = DEFAULT_MIN_PRESS_MS;
+  defaults.maxPressMs = DEFAULT_MAX_PRESS_MS;
+  defaults.maxIntervalMs = DEFAULT_MAX_INTERVAL_MS;
+  defaults.pressDurationMs = DEFAULT_PRESS_DURATION_MS;
+  defaults.pinCount = 0;
+  defaults.repeatLongPress = DEFAULT_REPEAT_LONG_PRESS;
+  defaults.name[0] = '\0';
+  profiles.push_back(defaults);
+  callbackTiming.edgeUs = 0;
+  callbackTiming.acceptedUs = 0;
+  for (int i = 0; i < PIN_SNAPSHOT_WORDS * 2; i++) {
+    levelWords[i] = 0;
+    publishedLevels[i].store(0, std::memory_order_relaxed);
+    publishedPins[i].store(0, std::memory_order_relaxed);
+  }
+  for (int i = 0; i < MAX_PIN_SLOTS; i++) {
+    publishedSlots[i].store(0, std::memory_order_relaxed);
+  }
+  publishedSlotCount.store(0, std::memory_order_relaxed);
+#if AVANT_TRACE_LEVEL > 0
+  traceBuffer = new AvantTraceBuffer;
+  for (int i = 0; i < AVANT_TRACE_BUFFER_SIZE; i++) {
+    traceBuffer->sequence[i].store(0, std::memory_order_relaxed);
+  }
+  traceBuffer->head.store(0, std::memory_order_relaxed);
+  traceBuffer->tail = 0;
+  traceBuffer->lost = 0;
+#endif
+#if AVANT_LATENCY_STATS
+  latencyTable = new AvantLatencyTable;
+  memset(latencyTable->index, 0, sizeof(latencyTable->index));
+#endif
+#if defined(ESP32)
+  samplingTask.store(nullptr, std::memory_order_relaxed);
+  dispatchTask.store(nullptr, std::memory_order_relaxed);
+  sampleTimer = nullptr;
+  changeLock = xSemaphoreCreateMutex();
+#endif
 }
 
 AvantDigitalRead::~AvantDigitalRead() {
   // Destructor, clean up resources
+  stopPipeline();
+  endTimerSampling();
   pinList.clear();
+  pinHandlers.clear();
+  pendingChanges.clear();
   delayedCallbacks.clear();
+  freeDelayedSlots.clear();
+  dueCallbacks.clear();
+  delete traceBuffer;
+  delete latencyTable;
+#if defined(ESP32)
+  vSemaphoreDelete(changeLock);
+#endif
 }
 
 // Find pin information
 PinInfo* AvantDigitalRead::findPin(int pin) {
   for (auto& pinInfo : pinList) {
-    if (pinInfo.pin == pin) {
+    if (pinInfo.inUse && pinInfo.pin == pin) {
       return &pinInfo;
     }
   }
   return nullptr;
 }
 
-// Trigger callback function
-void AvantDigitalRead::triggerCallback(PinCallback callback, int pin, PinState newState, 
-                                     PinState oldState, EventType event, 
-                                     unsigned long timestamp, unsigned long delayMs) {
-  if (callback == nullptr) {
-    return;
+// Find pin information from a handle without searching (nullptr if stale)
+PinInfo* AvantDigitalRead::resolvePin(PinHandle handle) {
+  size_t slot = (handle.value & 0xFFFF) - 1;
+  if (slot >= pinList.size()) {
+    return nullptr;
   }
-  
-  if (delayMs == 0) {
-    callback(pin, newState, oldState, event, timestamp);
-  } else {
-    // Create a new delayed callback entry
-    DelayedCallback delayedCb;
-    delayedCb.callback = callback;
-    delayedCb.pin = pin;
-    delayedCb.newState = newState;
-    delayedCb.oldState = oldState;
-    delayedCb.event = event;
-    delayedCb.timestamp = timestamp;
-    delayedCb.delayMs = delayMs;
-    delayedCb.executed = false;
-    
-    // Add to the list of delayed callbacks
-    delayedCallbacks.push_back(delayedCb);
-    
-    // Debug output - comment out or remove in production
-    #ifdef DEBUG_DELAYED_CALLBACKS
-    Serial.print("DEBUG: Added delayed callback for pin ");
-    Serial.print(pin);
-    Serial.print(", event: ");
-    Serial.print(event);
-    Serial.print(", delay: ");
-    Serial.print(delayMs);
-    Serial.print("ms, scheduled at ");
-    Serial.println(timestamp);
-    #endif
+  PinInfo& pinInfo = pinList[slot];
+  if (!pinInfo.inUse || pinInfo.generation != (uint16_t)(handle.value >> 16)) {
+    return nullptr;
   }
+  return &pinInfo;
 }
 
-// Process delayed callbacks
-void AvantDigitalRead::processDelayedCallbacks(unsigned long currentTime) {
-  // Create a temporary list to store callbacks that are ready to execute
-  std::vector<DelayedCallback> readyCallbacks;
-  
-  // Debug output - comment out or remove in production
-  #ifdef DEBUG_DELAYED_CALLBACKS
-  if (!delayedCallbacks.empty()) {
-    Serial.print("DEBUG: Processing ");
-    Serial.print(delayedCallbacks.size());
-    Serial.print(" delayed callbacks at time ");
-    Serial.println(currentTime);
-  }
-  #endif
-  
-  // Check each delayed callback
-  for (auto it = delayedCallbacks.begin(); it != delayedCallbacks.end(); ) {
-    if (!it->executed && currentTime - it->timestamp >= it->delayMs) {
-      // Debug output - comment out or remove in production
-      #ifdef DEBUG_DELAYED_CALLBACKS
-      Serial.print("DEBUG: Executing delayed callback for pin ");
-      Serial.print(it->pin);
-      Serial.print(", event: ");
-      Serial.print(it->event);
-      Serial.print(", scheduled at ");
-      Serial.print(it->timestamp);
-      Serial.print(", delay: ");
-      Serial.print(it->delayMs);
-      Serial.print("ms, elapsed: ");
-      Serial.print(currentTime - it->timestamp);
-      Serial.println("ms");
-      #endif
-      
-      // Add to ready list
-      readyCallbacks.push_back(*it);
-      // Remove from delayed list
-      it = delayedCallbacks.erase(it);
-    } else {
-      ++it;
-    }
+// Handle of a pin from pinList (invalid for nullptr)
+PinHandle AvantDigitalRead::handleOf(const PinInfo* pinInfo) {
+  if (pinInfo == nullptr) {
+    return PinHandle();
   }
-  
-  // Execute all ready callbacks
-  for (auto& cb : readyCallbacks) {
-    cb.callback(cb.pin, cb.newState, cb.oldState, cb.event, currentTime);
+  size_t slot = pinInfo - pinList.data();
+  return PinHandle(((uint32_t)pinInfo->generation << 16) | (uint32_t)(slot + 1));
+}
+
+// A deferred change of a pin; callers set the fields their change type uses
+static PendingPinChange pinChange(PinChangeType type, PinHandle handle) {
+  PendingPinChange change = {};
+  change.type = type;
+  change.handle = handle;
+  change.event = EVENT_CHANGE;
+  change.policy = THROTTLE_NONE;
+  change.other = PinHandle();
+  return change;
+}
+
+// Bit of a publishedSlots word set while the slot holds a pin
+static const uint32_t SLOT_IN_USE = 0x100;
+
+// Whether a timing parameter fits what PinInfo can hold (larger values are rejected, not clamped)
+static bool validTiming(unsigned long ms) {
+  return ms <= MAX_PIN_TIMING_MS;
+}
+
+// Whether two profiles have the same timing
+static bool sameTiming(const GestureProfile& a, const GestureProfile& b) {
+  return a.debounceTime == b.debounceTime && a.minPressMs == b.minPressMs &&
+         a.maxPressMs == b.maxPressMs && a.maxIntervalMs == b.maxIntervalMs &&
+         a.pressDurationMs == b.pressDurationMs && a.repeatLongPress == b.repeatLongPress;
+}
+
+// Find a named profile, returns -1 if there is none
+int AvantDigitalRead::findProfile(const char* name) {
+  if (name == nullptr || name[0] == '\0') {
+    return -1;
   }
+  for (size_t i = 0; i < profiles.size(); i++) {
+    if (strncmp(profiles[i].name, name, MAX_PROFILE_NAME_LENGTH) == 0) {
+      return (int)i;
+    }
+  }
+  return -1;
 }
 
-// Detect button gestures
-void AvantDigitalRead::detectButtonGestures(PinInfo* pinInfo, unsigned long currentTime) {
-  if (!pinInfo->eventsEnabled) return;
-  
-  // Check for long press (when button is pressed)
-  if (pinInfo->currentState == PIN_LOW && pinInfo->onLongPressCallback != nullptr) {
-    if (currentTime - pinInfo->pressStartTime >= pinInfo->pressDurationMs) {
-      // Long press triggered
-      if (pinInfo->repeatLongPress || !pinInfo->longPressTriggered) {
-        triggerCallback(pinInfo->onLongPressCallback, pinInfo->pin, pinInfo->currentState, 
-                       pinInfo->currentState, EVENT_LONG_PRESS, currentTime, pinInfo->onLongPressDelay);
-        pinInfo->longPressTriggered = true;
-      }
+// Store values in a free profile slot, returns -1 if all slots are used
+int AvantDigitalRead::allocateProfile(const GestureProfile& values) {
+  GestureProfile copy = values;  // values may live in profiles, which can reallocate
+  int slot = -1;
+  // Unnamed profiles no pin uses any more can be recycled (profile 0 stays)
+  for (size_t i = 1; i < profiles.size(); i++) {
+    if (profiles[i].name[0] == '\0' && profiles[i].pinCount == 0) {
+      slot = (int)i;
+      break;
     }
-  } else {
-    pinInfo->longPressTriggered = false;
   }
-  
-  // Check for click (when button is released)
-  if (pinInfo->currentState == PIN_HIGH) {
-    // If there was a previous press record
-    if (pinInfo->pressStartTime > 0) {
-      unsigned long pressDuration = currentTime - pinInfo->pressStartTime;
-      
-      // Check if press duration is within valid range
-      if (pressDuration >= pinInfo->minPressMs && pressDuration <= pinInfo->maxPressMs) {
-        // Check if it's a double press
-        if (pinInfo->clickCount == 2 && pinInfo->onDoublePressCallback != nullptr) {
-          // Check if interval between two clicks is within valid range
-          if (currentTime - pinInfo->lastClickTime <= pinInfo->maxIntervalMs) {
-            // Trigger double press event
-            triggerCallback(pinInfo->onDoublePressCallback, pinInfo->pin, pinInfo->currentState, 
-                           pinInfo->currentState, EVENT_DOUBLE_PRESS, currentTime, pinInfo->onDoublePressDelay);
-            pinInfo->clickCount = 0; // Reset click count
-          } else {
-            // Interval too long, treat as two single presses
-            if (pinInfo->onSinglePressCallback != nullptr) {
-              triggerCallback(pinInfo->onSinglePressCallback, pinInfo->pin, pinInfo->currentState, 
-                             pinInfo->currentState, EVENT_SINGLE_PRESS, currentTime, pinInfo->onSinglePressDelay);
-            }
-            pinInfo->clickCount = 1; // Keep current click as first click
-          }
-        } else if (pinInfo->clickCount == 1) {
-          // If no double press callback is set, or no second click after timeout, trigger single press event
-          if (pinInfo->onDoublePressCallback == nullptr) {
-            // No double press callback, directly trigger single press event
-            if (pinInfo->onSinglePressCallback != nullptr) {
-              triggerCallback(pinInfo->onSinglePressCallback, pinInfo->pin, pinInfo->currentState, 
-                             pinInfo->currentState, EVENT_SINGLE_PRESS, currentTime, pinInfo->onSinglePressDelay);
-            }
-            pinInfo->clickCount = 0; // Reset click count
-          }
-          // If double press callback is set, don't immediately trigger single press event, wait for possible second click
-          // Single press event will only be triggered after timeout, this logic is handled in the timeout check below
-        }
-        
-        // Update last click time
-        pinInfo->lastClickTime = currentTime;
-      } else if (pressDuration > pinInfo->maxPressMs) {
-        // Press duration too long, not considered a valid click
-        pinInfo->clickCount = 0;
-      }
-      
-      // Reset press start time
-      pinInfo->pressStartTime = 0;
+  if (slot < 0) {
+    if (profiles.size() >= (size_t)MAX_GESTURE_PROFILES) {
+      return -1;
     }
+    slot = (int)profiles.size();
+    profiles.push_back(copy);
   }
-  
-  // Check for single press timeout (when button is released)
-  if (pinInfo->currentState == PIN_HIGH && pinInfo->clickCount == 1 && 
-      pinInfo->onDoublePressCallback != nullptr && pinInfo->pressStartTime == 0) {
-    // If waited longer than maximum interval time, trigger single press event
-    if (currentTime - pinInfo->lastClickTime > pinInfo->maxIntervalMs) {
-      if (pinInfo->onSinglePressCallback != nullptr) {
-        triggerCallback(pinInfo->onSinglePressCallback, pinInfo->pin, pinInfo->currentState, 
-                       pinInfo->currentState, EVENT_SINGLE_PRESS, currentTime, pinInfo->onSinglePressDelay);
-      }
-      pinInfo->clickCount = 0; // Reset click count
+  profiles[slot] = copy;
+  profiles[slot].pinCount = 0;
+  profiles[slot].name[0] = '\0';
+  return slot;
+}
+
+// Index of an unnamed profile holding these values, created if needed (-1 if full)
+int AvantDigitalRead::internProfile(const GestureProfile& values) {
+  for (size_t i = 0; i < profiles.size(); i++) {
+    GestureProfile& profile = profiles[i];
+    if (profile.name[0] == '\0' && (i == 0 || profile.pinCount > 0) && sameTiming(profile, values)) {
+      return (int)i;
     }
   }
+  return allocateProfile(values);
 }
 
-// Add pin
-bool AvantDigitalRead::addPin(int pin, int mode) {
-  // Check if pin is already initialized
-  if (findPin(pin) != nullptr) {
+// Point a pin at another profile
+void AvantDigitalRead::assignProfile(PinInfo* pinInfo, int profile) {
+  profiles[pinInfo->profile].pinCount--;
+  profiles[profile].pinCount++;
+  pinInfo->profile = (uint8_t)profile;
+}
+
+// Give a pin its own timing (shared with pins having the same values)
+bool AvantDigitalRead::setPinTiming(PinInfo* pinInfo, const GestureProfile& values) {
+  if (sameTiming(profiles[pinInfo->profile], values)) {
+    return true;
+  }
+  // Release the current profile first so a profile only this pin used can be reused
+  profiles[pinInfo->profile].pinCount--;
+  int profile = internProfile(values);
+  profiles[pinInfo->profile].pinCount++;
+  if (profile < 0) {
     return false;
   }
-  
-  // Initialize pin
-  pinMode(pin, mode);
-  
-  // Create new pin information
-  PinInfo newPin;
-  newPin.pin = pin;
-  newPin.mode = mode;
-  newPin.currentState = (PinState)digitalRead(pin);
-  newPin.lastState = newPin.currentState;
-  newPin.lastDebounceTime = 0;
-  newPin.debounceTime = DEFAULT_DEBOUNCE_TIME; // Default debounce time
-  newPin.eventsEnabled = true;
-  
-  // Initialize callback functions
-  newPin.onChangeCallback = nullptr;
-  newPin.onChangeDelay = 0;
-  newPin.onRisingCallback = nullptr;
-  newPin.onRisingDelay = 0;
-  newPin.onFallingCallback = nullptr;
-  newPin.onFallingDelay = 0;
-  newPin.onSinglePressCallback = nullptr;
-  newPin.onSinglePressDelay = 0;
-  newPin.onDoublePressCallback = nullptr;
-  newPin.onDoublePressDelay = 0;
-  newPin.onLongPressCallback = nullptr;
-  newPin.onLongPressDelay = 0;
-  
-  // Initialize button parameters
-  newPin.minPressMs = DEFAULT_MIN_PRESS_MS;
-  newPin.maxPressMs = DEFAULT_MAX_PRESS_MS;
-  newPin.maxIntervalMs = DEFAULT_MAX_INTERVAL_MS;
-  newPin.pressDurationMs = DEFAULT_PRESS_DURATION_MS;
-  newPin.repeatLongPress = DEFAULT_REPEAT_LONG_PRESS;
-  
-  // Initialize button state tracking
-  newPin.pressStartTime = 0;
-  newPin.releaseTime = 0;
-  newPin.lastClickTime = 0;  // Add initialization for last click time
-  newPin.clickCount = 0;
-  newPin.longPressTriggered = false;
-  
-  // Add to list
-  pinList.push_back(newPin);
+  assignProfile(pinInfo, profile);
   return true;
 }
 
-// Remove pin
-bool AvantDigitalRead::removePin(int pin) {
-  for (auto it = pinList.begin(); it != pinList.end(); ++it) {
-    if (it->pin == pin) {
-      pinList.erase(it);
-      return true;
-    }
+// Copy the TimingField parts of values into a profile
+static void copyTiming(GestureProfile& target, const GestureProfile& values, uint8_t fields) {
+  if (fields & TIMING_DEBOUNCE) {
+    target.debounceTime = values.debounceTime;
+  }
+  if (fields & TIMING_CLICK) {
+    target.minPressMs = values.minPressMs;
+    target.maxPressMs = values.maxPressMs;
+  }
+  if (fields & TIMING_INTERVAL) {
+    target.maxIntervalMs = values.maxIntervalMs;
+  }
+  if (fields & TIMING_LONG_PRESS) {
+    target.pressDurationMs = values.pressDurationMs;
+    target.repeatLongPress = values.repeatLongPress;
   }
-  return false;
 }
 
-// Check if pin is initialized
-bool AvantDigitalRead::isInitialized(int pin) {
-  return findPin(pin) != nullptr;
+// Store a profile name (nullptr: unnamed)
+static void copyProfileName(GestureProfile& profile, const char* name) {
+  if (name == nullptr) {
+    profile.name[0] = '\0';
+    return;
+  }
+  strncpy(profile.name, name, MAX_PROFILE_NAME_LENGTH);
+  profile.name[MAX_PROFILE_NAME_LENGTH] = '\0';
 }
 
-// Get pin mode
-int AvantDigitalRead::getPinMode(int pin) {
-  PinInfo* pinInfo = findPin(pin);
-  if (pinInfo == nullptr) {
-    return PIN_UNINITIALIZED;
-  }
-  return pinInfo->mode;
+// Bit of an event type in PinInfo::subscribed
+static inline uint8_t eventBit(EventType event) {
+  return (uint8_t)(1u << event);
 }
 
-// Read pin state
-PinState AvantDigitalRead::readPin(int pin) {
-  PinInfo* pinInfo = findPin(pin);
-  if (pinInfo == nullptr) {
-    return PIN_UNINITIALIZED;
-  }
-  return pinInfo->currentState;
+// Handlers of a pin from pinList, in event order then subscription order
+std::vector<PinHandler>& AvantDigitalRead::handlersOf(const PinInfo* pinInfo) {
+  return pinHandlers[pinInfo - pinList.data()];
 }
 
-// Set debounce time
-bool AvantDigitalRead::setDebounceTime(int pin, unsigned long debounceMs) {
-  PinInfo* pinInfo = findPin(pin);
-  if (pinInfo == nullptr) {
-    return false;
+// Add a handler after the existing handlers of its event
+void AvantDigitalRead::addHandler(PinInfo* pinInfo, const PinHandler& handler) {
+  std::vector<PinHandler>& handlers = handlersOf(pinInfo);
+  size_t index = 0;
+  while (index < handlers.size() && handlers[index].event <= handler.event) {
+    index++;
   }
-  pinInfo->debounceTime = debounceMs;
-  return true;
+  handlers.insert(handlers.begin() + index, handler);
+  pinInfo->subscribed |= eventBit(handler.event);
 }
 
-// Get debounce time
-unsigned long AvantDigitalRead::getDebounceTime(int pin) {
-  PinInfo* pinInfo = findPin(pin);
-  if (pinInfo == nullptr) {
-    return DEFAULT_DEBOUNCE_TIME; // Return default value
+// Remove a handler and update PinInfo::subscribed
+void AvantDigitalRead::removeHandler(PinInfo* pinInfo, size_t index) {
+  std::vector<PinHandler>& handlers = handlersOf(pinInfo);
+  EventType event = handlers[index].event;
+  handlers.erase(handlers.begin() + index);
+  for (auto& handler : handlers) {
+    if (handler.event == event) {
+      return;
+    }
   }
-  return pinInfo->debounceTime;
+  pinInfo->subscribed &= (uint8_t)~eventBit(event);
 }
 
-// Set state change callback
-bool AvantDigitalRead::onChange(int pin, PinCallback callback, unsigned long delayMs) {
-  PinInfo* pinInfo = findPin(pin);
-  if (pinInfo == nullptr) {
-    return false;
+// Replace the onChange()/onRising()/... handler of an event (callback nullptr removes it)
+void AvantDigitalRead::setHandler(PinInfo* pinInfo, EventType event, PinCallback callback, unsigned long delayMs) {
+  std::vector<PinHandler>& handlers = handlersOf(pinInfo);
+  for (size_t i = 0; i < handlers.size(); i++) {
+    if (handlers[i].event == event && handlers[i].token == 0) {
+      if (callback == nullptr) {
+        removeHandler(pinInfo, i);
+      } else {
+        handlers[i].callback = callback;
+        handlers[i].delayMs = delayMs;
+      }
+      return;
+    }
+  }
+  if (callback != nullptr) {
+    PinHandler handler = {callback, delayMs, 0, event, false};
+    addHandler(pinInfo, handler);
   }
-  pinInfo->onChangeCallback = callback;
-  pinInfo->onChangeDelay = delayMs;
-  return true;
 }
 
-// Set rising edge callback
-bool AvantDigitalRead::onRising(int pin, PinCallback callback, unsigned long delayMs) {
-  PinInfo* pinInfo = findPin(pin);
+// setHandler() now, or at the next pass if changes are deferred
+bool AvantDigitalRead::changeHandler(PinHandle handle, EventType event, PinCallback callback, unsigned long delayMs) {
+  if (deferChanges()) {
+    if (!handle) {
+      return false;
+    }
+    PendingPinChange change = pinChange(PIN_CHANGE_SET_HANDLER, handle);
+    change.event = event;
+    change.callback = callback;
+    change.delayMs = delayMs;
+    queueChange(change);
+    return true;
+  }
+  applyPendingChanges();
+  PinInfo* pinInfo = resolvePin(handle);
   if (pinInfo == nullptr) {
     return false;
   }
-  pinInfo->onRisingCallback = callback;
-  pinInfo->onRisingDelay = delayMs;
+  setHandler(pinInfo, event, callback, delayMs);
   return true;
 }
 
-// Set falling edge callback
-bool AvantDigitalRead::onFalling(int pin, PinCallback callback, unsigned long delayMs) {
-  PinInfo* pinInfo = findPin(pin);
+// Set timing fields of a pin now, or at the next pass if changes are deferred
+bool AvantDigitalRead::changeTiming(PinHandle handle, const GestureProfile& values, uint8_t fields) {
+  if (deferChanges()) {
+    if (!handle) {
+      return false;
+    }
+    // update() may be reading the pin's profile: the new timing is swapped in between passes
+    PendingPinChange change = pinChange(PIN_CHANGE_TIMING, handle);
+    change.timing = values;
+    change.fields = fields;
+    queueChange(change);
+    return true;
+  }
+  applyPendingChanges();
+  PinInfo* pinInfo = resolvePin(handle);
   if (pinInfo == nullptr) {
     return false;
   }
-  pinInfo->onFallingCallback = callback;
-  pinInfo->onFallingDelay = delayMs;
-  return true;
+  GestureProfile timing = profiles[pinInfo->profile];
+  copyTiming(timing, values, fields);
+  return setPinTiming(pinInfo, timing);
 }
 
-// Set single press callback
-bool AvantDigitalRead::onSinglePress(int pin, PinCallback callback, unsigned long delayMs) {
-  PinInfo* pinInfo = findPin(pin);
-  if (pinInfo == nullptr) {
+// Change the timing of a named profile now, or at the next pass if changes are deferred
+bool AvantDigitalRead::changeProfileTiming(const char* name, const GestureProfile& values, uint8_t fields) {
+  if (deferChanges()) {
+    if (name == nullptr || name[0] == '\0') {
+      return false;
+    }
+    PendingPinChange change = pinChange(PIN_CHANGE_PROFILE_TIMING, PinHandle());
+    change.timing = values;
+    change.fields = fields;
+    copyProfileName(change.timing, name);
+    queueChange(change);
+    return true;
+  }
+  applyPendingChanges();
+  int profile = findProfile(name);
+  if (profile < 0) {
     return false;
   }
-  pinInfo->onSinglePressCallback = callback;
-  pinInfo->onSinglePressDelay = delayMs;
+  copyTiming(profiles[profile], values, fields);
   return true;
 }
 
-// Set click parameters
-bool AvantDigitalRead::setClickParameters(int pin, unsigned long minPressMs, unsigned long maxPressMs) {
-  PinInfo* pinInfo = findPin(pin);
+// Enable or disable the events of a pin (invalid handle: all pins)
+void AvantDigitalRead::setEventsEnabled(PinHandle handle, bool enabled) {
+  if (!handle) {
+    for (auto& pinInfo : pinList) {
+      if (pinInfo.inUse) {
+        setEventsEnabled(handleOf(&pinInfo), enabled);
+      }
+    }
+    return;
+  }
+  PinInfo* pinInfo = resolvePin(handle);
   if (pinInfo == nullptr) {
-    return false;
+    return;
   }
-  pinInfo->minPressMs = minPressMs;
-  pinInfo->maxPressMs = maxPressMs;
-  return true;
+  // Delayed calls of a disabled pin's events are stale; its timers are not events and keep running
+  if (!enabled) {
+    dropPendingCallbacks(pinInfo->pin, false);
+  }
+  pinInfo->eventsEnabled = enabled;
 }
 
-// Set double press callback
-bool AvantDigitalRead::onDoublePress(int pin, PinCallback callback, unsigned long delayMs, unsigned long maxIntervalMs) {
-  PinInfo* pinInfo = findPin(pin);
-  if (pinInfo == nullptr) {
-    return false;
-  }
-  pinInfo->onDoublePressCallback = callback;
-  pinInfo->onDoublePressDelay = delayMs;
-  pinInfo->maxIntervalMs = maxIntervalMs;
+// Queue a change that names a profile
+bool AvantDigitalRead::queueProfileChange(PinChangeType type, PinHandle handle, const char* name) {
+  PendingPinChange change = pinChange(type, handle);
+  copyProfileName(change.timing, name);
+  queueChange(change);
   return true;
 }
 
-// Set long press callback
-bool AvantDigitalRead::onLongPress(int pin, PinCallback callback, unsigned long delayMs, unsigned long pressDurationMs, bool repeat) {
-  PinInfo* pinInfo = findPin(pin);
-  if (pinInfo == nullptr) {
-    return false;
-  }
-  pinInfo->onLongPressCallback = callback;
-  pinInfo->onLongPressDelay = delayMs;
-  pinInfo->pressDurationMs = pressDurationMs;
-  pinInfo->repeatLongPress = repeat;
-  return true;
+// Whether update() or the pipeline may run in another task than the caller
+bool AvantDigitalRead::otherTasksActive() {
+  return deferredReconfiguration || pipelineRunning.load(std::memory_order_acquire);
 }
 
-// Enable pin events
-bool AvantDigitalRead::enablePinEvents(int pin) {
-  PinInfo* pinInfo = findPin(pin);
-  if (pinInfo == nullptr) {
-    return false;
-  }
-  pinInfo->eventsEnabled = true;
-  return true;
+// Whether pin table changes must wait for the next pass
+bool AvantDigitalRead::deferChanges() {
+  // Another task may be walking pinList, or a callback was called from inside the pin loop
+  return otherTasksActive() || inPass;
 }
 
-// Disable pin events
-bool AvantDigitalRead::disablePinEvents(int pin) {
-  PinInfo* pinInfo = findPin(pin);
-  if (pinInfo == nullptr) {
-    return false;
-  }
-  pinInfo->eventsEnabled = false;
+// Guard pendingChanges against the other task
+void AvantDigitalRead::lockChanges() {
+#if defined(ESP32)
+  xSemaphoreTake(changeLock, portMAX_DELAY);
+#elif !defined(ARDUINO)
+  changeLock.lock();
+#endif
+}
+
+// Take the lock if it is free (the sampling path never waits for a task queuing a change)
+bool AvantDigitalRead::tryLockChanges() {
+#if defined(ESP32)
+  return xSemaphoreTake(changeLock, 0) == pdTRUE;
+#elif !defined(ARDUINO)
+  return changeLock.try_lock();
+#else
   return true;
+#endif
 }
 
-// Enable all events
-void AvantDigitalRead::enableAllEvents() {
-  for (auto& pinInfo : pinList) {
-    pinInfo.eventsEnabled = true;
-  }
+void AvantDigitalRead::unlockChanges() {
+#if defined(ESP32)
+  xSemaphoreGive(changeLock);
+#elif !defined(ARDUINO)
+  changeLock.unlock();
+#endif
 }
 
-// Disable all events
-void AvantDigitalRead::disableAllEvents() {
-  for (auto& pinInfo : pinList) {
-    pinInfo.eventsEnabled = false;
-  }
+// Queue a change for the next pass
+void AvantDigitalRead::queueChange(const PendingPinChange& change) {
+  lockChanges();
+  pendingChanges.push_back(change);
+  changesPending.store(true, std::memory_order_release);
+  unlockChanges();
 }
 
-// Core update function
-void AvantDigitalRead::update() {
-  unsigned long currentTime = millis();
-  
-  for (auto& pinInfo : pinList) {
-    // Read current pin state
-    int rawReading = digitalRead(pinInfo.pin);
-    
-    // Debounce processing
-    if (rawReading != pinInfo.lastState) {
-      pinInfo.lastDebounceTime = currentTime;
-    }
-    
-    if ((currentTime - pinInfo.lastDebounceTime) > pinInfo.debounceTime) {
-      // If state is stable, update state
-      if (rawReading != pinInfo.currentState) {
-        // Save previous state
-        PinState previousState = pinInfo.currentState;
-        
-        // Update current state
-        pinInfo.currentState = (PinState)rawReading;
-        
-        // Check button press and release
-        if (pinInfo.currentState == PIN_LOW && previousState == PIN_HIGH) {
-          // Button pressed (in INPUT_PULLUP mode, press is LOW)
-          pinInfo.pressStartTime = currentTime;
-          pinInfo.clickCount++; // Increase click count
+// Apply the queued changes (called before each pass; wait false: skip them if they are being queued)
+void AvantDigitalRead::applyPendingChanges(bool wait) {
+  // The only cost on the hot path when nothing is queued
+  if (!changesPending.load(std::memory_order_acquire)) {
+    return;
+  }
+  // A pass does not wait for another task that holds the lock: the next pass applies the changes
+  if (wait) {
+    lockChanges();
+  } else if (!tryLockChanges()) {
+    return;
+  }
+  for (auto& change : pendingChanges) {
+    PinInfo* pinInfo = change.handle ? resolvePin(change.handle) : nullptr;
+    switch (change.type) {
+      case PIN_CHANGE_ADD:
+        addPinToSlot(change.pin, change.mode, (change.handle.value & 0xFFFF) - 1);
+        break;
+      case PIN_CHANGE_REMOVE:
+        if (pinInfo != nullptr) {
+          freePin(pinInfo);
         }
-        
-        // Trigger event callbacks
-        if (pinInfo.eventsEnabled) {
-          // State change event
-          if (pinInfo.onChangeCallback != nullptr) {
-            triggerCallback(pinInfo.onChangeCallback, pinInfo.pin, pinInfo.currentState, 
-                           previousState, EVENT_CHANGE, currentTime, pinInfo.onChangeDelay);
-          }
-          
-          // Rising edge event (from LOW to HIGH)
-          if (pinInfo.currentState == PIN_HIGH && previousState == PIN_LOW && pinInfo.onRisingCallback != nullptr) {
-            triggerCallback(pinInfo.onRisingCallback, pinInfo.pin, pinInfo.currentState, 
-                           previousState, EVENT_RISING, currentTime, pinInfo.onRisingDelay);
-          }
-          
-          // Falling edge event (from HIGH to LOW)
-          if (pinInfo.currentState == PIN_LOW && previousState == PIN_HIGH && pinInfo.onFallingCallback != nullptr) {
-            triggerCallback(pinInfo.onFallingCallback, pinInfo.pin, pinInfo.currentState, 
-                           previousState, EVENT_FALLING, currentTime, pinInfo.onFallingDelay);
+        break;
+      case PIN_CHANGE_SET_HANDLER:
+        if (pinInfo != nullptr) {
+          setHandler(pinInfo, change.event, change.callback, change.delayMs);
+        }
+        break;
+      case PIN_CHANGE_SUBSCRIBE:
+        if (pinInfo != nullptr) {
+          PinHandler handler = {change.callback, change.delayMs, change.token, change.event, change.enabled};
+          addHandler(pinInfo, handler);
+        }
+        break;
+      case PIN_CHANGE_UNSUBSCRIBE:
+        removeSubscription(change.token);
+        break;
+      case PIN_CHANGE_RESERVE:
+        if (pinInfo != nullptr) {
+          handlersOf(pinInfo).reserve(change.count);
+        }
+        break;
+      case PIN_CHANGE_TIMING:
+        if (pinInfo != nullptr) {
+          GestureProfile timing = profiles[pinInfo->profile];
+          copyTiming(timing, change.timing, change.fields);
+          setPinTiming(pinInfo, timing);
+        }
+        break;
+      case PIN_CHANGE_EVENTS:
+        setEventsEnabled(change.handle, change.enabled);
+        break;
+      case PIN_CHANGE_SET_PROFILE:
+        if (pinInfo != nullptr) {
+          int profile = change.timing.name[0] == '\0' ? 0 : findProfile(change.timing.name);
+          if (profile >= 0) {
+            assignProfile(pinInfo, profile);
           }
         }
+        break;
+      case PIN_CHANGE_ADD_PROFILE:
+        createProfile(change.timing.name);
+        break;
+      case PIN_CHANGE_REMOVE_PROFILE: {
+        int profile = findProfile(change.timing.name);
+        if (profile >= 0) {
+          profiles[profile].name[0] = '\0';
+        }
+        break;
       }
+      case PIN_CHANGE_PROFILE_TIMING: {
+        int profile = findProfile(change.timing.name);
+        if (profile >= 0) {
+          copyTiming(profiles[profile], change.timing, change.fields);
+        }
+        break;
+      }
+      case PIN_CHANGE_REPLACE_PENDING:
+        if (pinInfo != nullptr) {
+          pinInfo->replacePending = change.enabled;
+        }
+        break;
+      case PIN_CHANGE_SPECULATIVE:
+        if (pinInfo != nullptr) {
+          pinInfo->speculativeSingle = change.enabled;
+        }
+        break;
+      case PIN_CHANGE_THROTTLE:
+        if (pinInfo != nullptr) {
+          applyThrottle(pinInfo, change.policy, change.delayMs, change.count);
+        }
+        break;
+      case PIN_CHANGE_ADD_ENCODER:
+        if (pinInfo != nullptr && resolvePin(change.other) != nullptr) {
+          addEncoderToTable(change.handle, change.other, change.callback, (uint8_t)change.count, change.mode);
+        }
+        break;
+      case PIN_CHANGE_REMOVE_ENCODER:
+        removeEncoderFromTable(change.handle);
+        break;
+      case PIN_CHANGE_COUNTER:
+        if (pinInfo != nullptr) {
+          applyCounter(pinInfo, change.enabled, change.event, change.delayMs, change.callback);
+        }
+        break;
     }
-    
-    // Update lastState to current raw reading (for next comparison)
-    pinInfo.lastState = (PinState)rawReading;
-    
-    // Detect button gestures
-    detectButtonGestures(&pinInfo, currentTime);
   }
-  
-  // Process delayed callbacks
-  processDelayedCallbacks(currentTime);
-}
\ No newline at end of file
+  pendingChanges.clear();
+  changesPending.store(false, std::memory_order_release);
+  unlockChanges();
+}
+
+// Slot a new pin will get, counting the adds still queued (changeLock held)
+size_t AvantDigitalRead::predictSlot() {
+  size_t slot = 0;
+  while (true) {
+    // The published slots: pinList may be growing in the sampler's task
+    bool taken = (slotWord(slot) & SLOT_IN_USE) != 0;
+    for (size_t i = 0; i < pendingChanges.size() && !taken; i++) {
+      taken = pendingChanges[i].type == PIN_CHANGE_ADD &&
+              (pendingChanges[i].handle.value & 0xFFFF) - 1 == slot;
+    }
+    if (!taken) {
+      return slot;
+    }
+    slot++;
+  }
+}
+
+// Handle a pin will have once the queued changes are applied (changeLock held)
+PinHandle AvantDigitalRead::pendingHandle(int pin) {
+  PinHandle handle = publishedHandle(pin);
+  for (auto& change : pendingChanges) {
+    if (change.type == PIN_CHANGE_ADD && change.pin == pin) {
+      handle = change.handle;
+    } else if (change.type == PIN_CHANGE_REMOVE && change.handle == handle) {
+      handle = PinHandle();
+    }
+  }
+  return handle;
+}
+
+// Published slot word of a pin table slot (0: never used)
+uint32_t AvantDigitalRead::slotWord(size_t slot) {
+  return slot < (size_t)MAX_PIN_SLOTS ? publishedSlots[slot].load(std::memory_order_acquire) : 0;
+}
+
+// Handle of a pin from the published snapshot (invalid if there is none)
+PinHandle AvantDigitalRead::publishedHandle(int pin) {
+  if (pin < 0 || pin >= MAX_PIN_SLOTS) {
+    return PinHandle();
+  }
+  uint32_t handle;
+  uint32_t before;
+  do {
+    before = snapshotSequence.load(std::memory_order_acquire);
+    handle = 0;
+    uint32_t count = publishedSlotCount.load(std::memory_order_relaxed);
+    for (uint32_t slot = 0; slot < count && handle == 0; slot++) {
+      uint32_t word = publishedSlots[slot].load(std::memory_order_relaxed);
+      if ((word & SLOT_IN_USE) && (int)(word & 0xFF) == pin) {
+        handle = (word & 0xFFFF0000u) | (slot + 1);
+      }
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Retry if a pin moved while the slots were searched
+  } while ((before & 1) || before != snapshotSequence.load(std::memory_order_relaxed));
+  return PinHandle(handle);
+}
+
+// Grow the pin table so AVANT_PIN_HEADROOM more pins fit without moving it
+void AvantDigitalRead::reservePinHeadroom() {
+  pinList.reserve(pinList.size() + AVANT_PIN_HEADROOM);
+  pinHandlers.reserve(pinList.size() + AVANT_PIN_HEADROOM);
+}
+
+// Give a pin a throttle policy (THROTTLE_NONE frees its PinThrottle)
+bool AvantDigitalRead::applyThrottle(PinInfo* pinInfo, ThrottlePolicy policy, unsigned long windowMs, size_t maxEvents) {
+  if (policy == THROTTLE_NONE) {
+    if (pinInfo->throttle != 0) {
+      throttles[pinInfo->throttle - 1].policy = THROTTLE_NONE;
+      pinInfo->throttle = 0;
+    }
+    return true;
+  }
+  if (pinInfo->throttle == 0) {
+    // Reuse the entry of a pin that is no longer throttled
+    size_t index = 0;
+    while (index < throttles.size() && throttles[index].policy != THROTTLE_NONE) {
+      index++;
+    }
+    if (index >= 255) {
+      return false;
+    }
+    if (index == throttles.size()) {
+      throttles.push_back(PinThrottle());
+    }
+    throttles[index].suppressed = 0;
+    pinInfo->throttle = (uint8_t)(index + 1);
+  }
+  PinThrottle& throttle = throttles[pinInfo->throttle - 1];
+  throttle.policy = (uint8_t)policy;
+  throttle.maxEvents = (uint8_t)(maxEvents < 1 ? 1 : (maxEvents > 255 ? 255 : maxEvents));
+  throttle.windowEvents = 0;
+  throttle.pending = false;
+  throttle.heldState = pinInfo->currentState;
+  throttle.windowMs = (uint16_t)windowMs;
+  throttle.windowStart = 0;
+  throttle.lastEdge = 0;
+  return true;
+}
+
+// Whether a transition of a throttled pin gets its edge events now
+bool AvantDigitalRead::admitEdge(PinInfo& pinInfo, PinState previousState, unsigned long currentTime) {
+  PinThrottle& throttle = throttles[pinInfo.throttle - 1];
+  if (throttle.policy != THROTTLE_TRAILING) {
+    if (throttle.windowEvents == 0 || currentTime - throttle.windowStart >= throttle.windowMs) {
+      throttle.windowStart = currentTime;
+      throttle.windowEvents = 0;
+    }
+    // Held-back transitions are released in order, so nothing overtakes them
+    if (!throttle.pending && throttle.windowEvents < throttle.maxEvents) {
+      throttle.windowEvents++;
+      return true;
+    }
+  }
+  throttle.suppressed++;
+  throttle.lastEdge = currentTime;
+  if (throttle.policy != THROTTLE_LIMIT && !throttle.pending) {
+    throttle.pending = true;
+    throttle.heldState = previousState;
+  }
+  return false;
+}
+
+// Emit the coalesced event of a throttled pin once its window is over
+void AvantDigitalRead::flushThrottle(PinInfo& pinInfo, unsigned long currentTime) {
+  PinThrottle& throttle = throttles[pinInfo.throttle - 1];
+  if (!throttle.pending) {
+    return;
+  }
+  if (throttle.policy == THROTTLE_TRAILING) {
+    if (currentTime - throttle.lastEdge < throttle.windowMs) {
+      return;
+    }
+  } else if (currentTime - throttle.windowStart < throttle.windowMs) {
+    return;
+  }
+  throttle.pending = false;
+  
+  // The coalesced event counts against the window it opens
+  throttle.windowStart = currentTime;
+  throttle.windowEvents = 1;
+  
+  // Transitions that cancelled out are not reported
+  PinState newState = (PinState)pinInfo.currentState;
+  PinState oldState = (PinState)throttle.heldState;
+  if (newState != oldState && pinInfo.eventsEnabled) {
+    uint8_t edgeEvents = eventBit(EVENT_CHANGE) |
+                         eventBit(newState == PIN_HIGH ? EVENT_RISING : EVENT_FALLING);
+    emitPinEvents(&pinInfo, edgeEvents, newState, oldState, currentTime);
+  }
+}
+
+// Record the debounced level of a pin for the next snapshot
+void AvantDigitalRead::setLevel(const PinInfo* pinInfo, bool high) {
+  uint32_t bit = 1u << (pinInfo->pin & 31);
+  uint32_t& word = levelWords[pinInfo->pin >> 5];
+  word = high ? (word | bit) : (word & ~bit);
+  levelsChanged = true;
+}
+
+// Publish levelWords to other tasks if it changed
+void AvantDigitalRead::publishLevels() {
+  if (levelsChanged) {
+    publishSnapshot(nullptr);
+  }
+}
+
+// Publish the levels, and the slot of a pin added to or taken out of the table (changedPin)
+void AvantDigitalRead::publishSnapshot(const PinInfo* changedPin) {
+  // Single writer: the sequence is odd while the words are being stored
+  uint32_t sequence = snapshotSequence.load(std::memory_order_relaxed);
+  snapshotSequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (int i = 0; i < PIN_SNAPSHOT_WORDS * 2; i++) {
+    publishedLevels[i].store(levelWords[i], std::memory_order_relaxed);
+  }
+  if (changedPin != nullptr) {
+    uint32_t bit = 1u << (changedPin->pin & 31);
+    std::atomic<uint32_t>& pins = publishedPins[changedPin->pin >> 5];
+    uint32_t word = pins.load(std::memory_order_relaxed);
+    pins.store(changedPin->inUse ? (word | bit) : (word & ~bit), std::memory_order_relaxed);
+    uint32_t slot = (uint32_t)(changedPin - pinList.data());
+    publishedSlots[slot].store(((uint32_t)changedPin->generation << 16) |
+                               (changedPin->inUse ? SLOT_IN_USE : 0) | changedPin->pin,
+                               std::memory_order_relaxed);
+    if (slot >= publishedSlotCount.load(std::memory_order_relaxed)) {
+      publishedSlotCount.store(slot + 1, std::memory_order_relaxed);
+    }
+  }
+  snapshotSequence.store(sequence + 2, std::memory_order_release);
+  levelsChanged = false;
+}
+
+// Emit the events in eventMask that the pin has handlers for
+void AvantDigitalRead::emitPinEvents(PinInfo* pinInfo, uint8_t eventMask, PinState newState,
+                                     PinState oldState, unsigned long timestamp) {
+  uint8_t pending = eventMask & pinInfo->subscribed;
+  if (pending == 0) {
+    return;
+  }
+  EventTiming timing = {pinInfo->edgeTimeUs, readingTimeUs};
+  
+  // Index loop with a copied handler: a callback run directly may change the pin's subscriptions
+  for (size_t i = 0; i < handlersOf(pinInfo).size(); i++) {
+    PinHandler handler = handlersOf(pinInfo)[i];
+    if (pending & eventBit(handler.event)) {
+      emitEvent(handler.callback, pinInfo->pin, newState, oldState, handler.event, timestamp,
+                handler.delayMs, handler.replacePending || pinInfo->replacePending, timing);
+    }
+  }
+}
+
+// Move timeEpoch forward before pins are processed at currentTime
+void AvantDigitalRead::advanceEpoch(unsigned long currentTime) {
+  unsigned long elapsed = currentTime - timeEpoch;
+  if (elapsed < TIME_REBASE_THRESHOLD_MS) {
+    return;
+  }
+  // Keep the last TIME_REBASE_KEEP_MS of history exact, saturate anything older
+  unsigned long shift = elapsed - TIME_REBASE_KEEP_MS;
+  timeEpoch += shift;
+  for (auto& pinInfo : pinList) {
+    pinInfo.lastDebounceTime = pinInfo.lastDebounceTime > shift ? pinInfo.lastDebounceTime - shift : 0;
+    pinInfo.pressStartTime = pinInfo.pressStartTime > shift ? pinInfo.pressStartTime - shift : 0;
+    pinInfo.lastClickTime = pinInfo.lastClickTime > shift ? pinInfo.lastClickTime - shift : 0;
+  }
+}
+
+// Trigger callback function
+void AvantDigitalRead::triggerCallback(PinCallback callback, int pin, PinState newState, 
+                                     PinState oldState, EventType event, 
+                                     unsigned long timestamp, unsigned long delayMs,
+                                     bool replacePending, const EventTiming& timing) {
+  if (callback == nullptr) {
+    return;
+  }
+  
+  // A demoted callback goes through the delayed calls, which run after the pass
+  if (delayMs == 0 && !(deferSlowCallbacks && isDeferredCallback(callback))) {
+    runCallback(callback, pin, newState, oldState, event, timestamp, timing);
+  } else {
+    // Replace the call still pending for this handler, restarting its delay
+    if (replacePending) {
+      for (auto& pendingCb : delayedCallbacks) {
+        if (pendingCb.callback == callback && pendingCb.pin == pin && pendingCb.event == event && !pendingCb.executed) {
+          pendingCb.newState = newState;
+          pendingCb.oldState = oldState;
+          pendingCb.timestamp = timestamp;
+          pendingCb.delayMs = delayMs;
+          pendingCb.timing = timing;
+          pushDue(&pendingCb - delayedCallbacks.data());
+          AVANT_TRACE(TRACE_LEVEL_CALLBACKS, TRACE_DELAYED_REPLACED, pin, event,
+                      (uint32_t)(timestamp + delayMs) * 1000u, delayMs);
+          return;
+        }
+      }
+    }
+    
+    // Create a new delayed callback entry
+    DelayedCallback delayedCb;
+    delayedCb.callback = callback;
+    delayedCb.pin = pin;
+    delayedCb.newState = newState;
+    delayedCb.oldState = oldState;
+    delayedCb.event = event;
+    delayedCb.timestamp = timestamp;
+    delayedCb.delayMs = delayMs;
+    delayedCb.periodMs = 0;
+    delayedCb.timing = timing;
+    
+    // Add to the list of delayed callbacks
+    scheduleDelayed(delayedCb);
+  }
+}
+
+// Emit an event, directly or through the event queue
+void AvantDigitalRead::emitEvent(PinCallback callback, int pin, PinState newState,
+                                 PinState oldState, EventType event,
+                                 unsigned long timestamp, unsigned long delayMs,
+                                 bool replacePending, const EventTiming& timing) {
+  AVANT_TRACE(TRACE_LEVEL_EVENTS, TRACE_EVENT, pin, event, timing.edgeUs, delayMs);
+  if (!queueEvents) {
+    triggerCallback(callback, pin, newState, oldState, event, timestamp, delayMs, replacePending, timing);
+    return;
+  }
+
+  // Sampling stage: hand the event over to the dispatch stage
+  QueuedEvent queued;
+  queued.callback = callback;
+  queued.pin = pin;
+  queued.newState = newState;
+  queued.oldState = oldState;
+  queued.event = event;
+  queued.timestamp = timestamp;
+  queued.delayMs = delayMs;
+  queued.replacePending = replacePending;
+  queued.timing = timing;
+  if (!eventQueue.push(queued)) {
+    // Never block the sampler; count the loss instead
+    droppedEvents.fetch_add(1, std::memory_order_relaxed);
+    AVANT_TRACE(TRACE_LEVEL_EVENTS, TRACE_EVENT_DROPPED, pin, event, timing.edgeUs, delayMs);
+  }
+}
+
+#if AVANT_LATENCY_STATS
+// Histogram bucket of a time in us: its bit length, capped at the last bucket
+static inline int latencyBucket(uint32_t us) {
+  int bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+  return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+#endif
+
+// Heap order of dueCallbacks: the earliest due time on top (millis() wrap-safe), calls
+// due at the same time in the order they were scheduled
+static bool laterDue(const DueCallback& a, const DueCallback& b) {
+  if (a.due != b.due) {
+    return (long)(a.due - b.due) > 0;
+  }
+  return (int32_t)(a.sequence - b.sequence) > 0;
+}
+
+// Process delayed callbacks
+void AvantDigitalRead::processDelayedCallbacks(unsigned long currentTime) {
+  // Only the calls that are due are visited, earliest first
+  while (!dueCallbacks.empty() && (long)(currentTime - dueCallbacks.front().due) >= 0) {
+    DueCallback next = dueCallbacks.front();
+    std::pop_heap(dueCallbacks.begin(), dueCallbacks.end(), laterDue);
+    dueCallbacks.pop_back();
+    
+    // Skip entries of cancelled calls and the old due time of restarted ones
+    size_t slot = (next.handle & 0xFFFF) - 1;
+    DelayedCallback& delayedCb = delayedCallbacks[slot];
+    if (delayedCb.executed || delayedCb.generation != (uint16_t)(next.handle >> 16) ||
+        delayedCb.timestamp + delayedCb.delayMs != next.due) {
+      continue;
+    }
+    
+    AVANT_TRACE(TRACE_LEVEL_CALLBACKS, TRACE_DELAYED_RUN, delayedCb.pin, delayedCb.event,
+                (uint32_t)next.due * 1000u, currentTime - next.due);
+    
+    DelayedCallback cb = delayedCb;
+    if (cb.periodMs != 0) {
+      // Periodic timer: next period, skipping the ones missed while update() was late
+      delayedCb.timestamp = next.due;
+      delayedCb.delayMs = cb.periodMs;
+      if (currentTime - delayedCb.timestamp >= cb.periodMs) {
+        delayedCb.timestamp = currentTime;
+      }
+      pushDue(slot);
+      
+      // A timer reports the time it was due
+      delayedCb.timing.edgeUs = (uint32_t)(delayedCb.timestamp + delayedCb.delayMs) * 1000u;
+      delayedCb.timing.acceptedUs = delayedCb.timing.edgeUs;
+      
+      // A timer reports the last published level of its pin
+      if (cb.event == EVENT_TIMER && cb.pin >= 0 && cb.pin < PIN_SNAPSHOT_WORDS * 64) {
+        uint32_t word = publishedLevels[cb.pin >> 5].load(std::memory_order_acquire);
+        cb.newState = (word >> (cb.pin & 31)) & 1 ? PIN_HIGH : PIN_LOW;
+        cb.oldState = cb.newState;
+      }
+    } else {
+      releaseDelayed(slot);
+    }
+    runCallback(cb.callback, cb.pin, cb.newState, cb.oldState, cb.event, currentTime, cb.timing);
+  }
+}
+
+// Run a callback (the one place callbacks are called, timed with AVANT_LATENCY_STATS)
+void AvantDigitalRead::runCallback(PinCallback callback, int pin, PinState newState, PinState oldState,
+                                   EventType event, unsigned long timestamp, const EventTiming& timing) {
+  callbackTiming = timing;
+  bool timed = callbackBudgetUs != 0 || AVANT_TRACE_LEVEL >= TRACE_LEVEL_EVENTS;
+#if AVANT_LATENCY_STATS
+  uint8_t index = (unsigned)pin < 256 ? latencyTable->index[pin] : 0;
+  timed = timed || index != 0;
+#endif
+  if (!timed) {
+    callback(pin, newState, oldState, event, timestamp);
+    return;
+  }
+  
+  uint32_t start = micros();
+  callback(pin, newState, oldState, event, timestamp);
+  uint32_t duration = (uint32_t)micros() - start;
+  AVANT_TRACE(TRACE_LEVEL_EVENTS, TRACE_CALLBACK, pin, event, start, duration);
+  if (callbackBudgetUs != 0) {
+    recordCallbackTime(callback, pin, event, duration);
+  }
+  
+#if AVANT_LATENCY_STATS
+  if (index == 0) {
+    return;
+  }
+  uint32_t latency = start - timing.edgeUs;
+  
+  // Look the histogram up after the call: the callback may have enabled other pins
+  LatencyHistogram& histogram = latencyTable->stats[(index - 1) * LATENCY_EVENT_TYPES + event];
+  histogram.latency[latencyBucket(latency)]++;
+  histogram.duration[latencyBucket(duration)]++;
+  histogram.count++;
+  if (latency > histogram.maxLatencyUs) {
+    histogram.maxLatencyUs = latency;
+  }
+  if (duration > histogram.maxDurationUs) {
+    histogram.maxDurationUs = duration;
+  }
+#endif
+}
+
+// Record the run time of a callback while a budget is set
+void AvantDigitalRead::recordCallbackTime(PinCallback callback, int pin, EventType event, uint32_t durationUs) {
+  CallbackStats* stats = nullptr;
+  for (auto& entry : callbackStats) {
+    if (entry.callback == callback) {
+      stats = &entry;
+      break;
+    }
+  }
+  if (stats == nullptr) {
+    CallbackStats entry = {callback, 0, 0, pin, event, 0, false};
+    callbackStats.push_back(entry);
+    stats = &callbackStats.back();
+  }
+  
+  stats->calls++;
+  if (durationUs > stats->worstUs) {
+    stats->worstUs = durationUs;
+    stats->worstPin = pin;
+    stats->worstEvent = event;
+  }
+  if (durationUs <= callbackBudgetUs) {
+    return;
+  }
+  
+  stats->overruns++;
+  AVANT_TRACE(TRACE_LEVEL_EVENTS, TRACE_SLOW_CALLBACK, pin, event, callbackTiming.edgeUs, durationUs);
+  if (deferSlowCallbacks) {
+    stats->deferred = true;
+  }
+  if (slowCallbackHook != nullptr) {
+    slowCallbackHook(callback, pin, event, durationUs);
+  }
+}
+
+// Whether a callback was demoted to run after the pass
+bool AvantDigitalRead::isDeferredCallback(PinCallback callback) {
+  for (const auto& entry : callbackStats) {
+    if (entry.callback == callback) {
+      return entry.deferred;
+    }
+  }
+  return false;
+}
+
+// Add the current due time of a slot to dueCallbacks
+void AvantDigitalRead::pushDue(size_t slot) {
+  // Rebuild the heap when skipped entries of cancelled or restarted calls pile up
+  if (dueCallbacks.size() > 2 * pendingDelayed + 32) {
+    dueCallbacks.clear();
+    for (size_t i = 0; i < delayedCallbacks.size(); i++) {
+      if (!delayedCallbacks[i].executed && i != slot) {
+        DueCallback entry = {delayedCallbacks[i].timestamp + delayedCallbacks[i].delayMs,
+                             delayedCallbacks[i].sequence,
+                             ((uint32_t)delayedCallbacks[i].generation << 16) | (uint32_t)(i + 1)};
+        dueCallbacks.push_back(entry);
+      }
+    }
+    std::make_heap(dueCallbacks.begin(), dueCallbacks.end(), laterDue);
+  }
+  DelayedCallback& delayedCb = delayedCallbacks[slot];
+  delayedCb.sequence = nextDueSequence++;
+  DueCallback entry = {delayedCb.timestamp + delayedCb.delayMs, delayedCb.sequence,
+                       ((uint32_t)delayedCb.generation << 16) | (uint32_t)(slot + 1)};
+  dueCallbacks.push_back(entry);
+  std::push_heap(dueCallbacks.begin(), dueCallbacks.end(), laterDue);
+}
+
+// Store a delayed call in a free slot
+CallbackHandle AvantDigitalRead::scheduleDelayed(const DelayedCallback& delayedCb) {
+  size_t slot;
+  if (!freeDelayedSlots.empty()) {
+    slot = freeDelayedSlots.back();
+    freeDelayedSlots.pop_back();
+  } else {
+    if (delayedCallbacks.size() >= 0xFFFF) {
+      return 0;
+    }
+    slot = delayedCallbacks.size();
+    DelayedCallback unused = delayedCb;
+    unused.generation = 0;
+    delayedCallbacks.push_back(unused);
+  }
+  DelayedCallback& entry = delayedCallbacks[slot];
+  uint16_t generation = entry.generation;
+  entry = delayedCb;
+  entry.executed = false;
+  entry.generation = generation;
+  pendingDelayed++;
+  pushDue(slot);
+  AVANT_TRACE(TRACE_LEVEL_CALLBACKS, TRACE_DELAYED_ADDED, entry.pin, entry.event,
+              (uint32_t)(entry.timestamp + entry.delayMs) * 1000u, entry.delayMs);
+  return ((uint32_t)generation << 16) | (uint32_t)(slot + 1);
+}
+
+// Free the slot of a delayed call
+void AvantDigitalRead::releaseDelayed(size_t slot) {
+  delayedCallbacks[slot].executed = true;
+  delayedCallbacks[slot].generation++;
+  freeDelayedSlots.push_back((uint16_t)slot);
+  pendingDelayed--;
+}
+
+// Drop the delayed calls of a pin (timers: also its startTimer() timers), or hand that to the dispatch stage
+void AvantDigitalRead::dropPendingCallbacks(int pin, bool timers) {
+  if (!queueEvents) {
+    cancelPending(pin, timers);
+    return;
+  }
+  // Only the dispatch stage touches delayedCallbacks: send it a marker after the pin's last events
+  QueuedEvent marker;
+  marker.callback = nullptr;
+  marker.pin = pin;
+  marker.newState = PIN_UNINITIALIZED;
+  marker.oldState = PIN_UNINITIALIZED;
+  marker.event = timers ? EVENT_TIMER : EVENT_CHANGE;
+  marker.timestamp = 0;
+  marker.delayMs = 0;
+  marker.replacePending = false;
+  marker.timing.edgeUs = 0;
+  marker.timing.acceptedUs = 0;
+  if (!eventQueue.push(marker)) {
+    droppedEvents.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// Detect button gestures
+void AvantDigitalRead::detectButtonGestures(PinInfo* pinInfo, unsigned long currentTime) {
+  if (!pinInfo->eventsEnabled) return;
+  
+  const GestureProfile& profile = profiles[pinInfo->profile];
+  PinState state = (PinState)pinInfo->currentState;
+  uint16_t now = (uint16_t)(currentTime - timeEpoch);
+  
+  // Check for long press (when button is pressed)
+  if (pinInfo->currentState == PIN_LOW && (pinInfo->subscribed & eventBit(EVENT_LONG_PRESS))) {
+    if ((uint16_t)(now - pinInfo->pressStartTime) >= profile.pressDurationMs) {
+      // Long press triggered
+      if (profile.repeatLongPress || !pinInfo->longPressTriggered) {
+        emitPinEvents(pinInfo, eventBit(EVENT_LONG_PRESS), state, state, currentTime);
+        pinInfo->longPressTriggered = true;
+      }
+    }
+  } else {
+    pinInfo->longPressTriggered = false;
+  }
+  
+  // Check for click (when button is released)
+  if (pinInfo->currentState == PIN_HIGH) {
+    // If there was a previous press record
+    if (pinInfo->pressActive) {
+      uint16_t pressDuration = now - pinInfo->pressStartTime;
+      
+      // Check if press duration is within valid range
+      if (pressDuration >= profile.minPressMs && pressDuration <= profile.maxPressMs) {
+        // Check if it's a double press
+        if (pinInfo->clickCount == 2 && (pinInfo->subscribed & eventBit(EVENT_DOUBLE_PRESS))) {
+          // Check if interval between two clicks is within valid range
+          if ((uint16_t)(now - pinInfo->lastClickTime) <= profile.maxIntervalMs) {
+            // Take back the speculative single press of the first click
+            if (pinInfo->speculativeSingle) {
+              emitPinEvents(pinInfo, eventBit(EVENT_SINGLE_PRESS_RETRACT), state, state, currentTime);
+            }
+            // Trigger double press event
+            emitPinEvents(pinInfo, eventBit(EVENT_DOUBLE_PRESS), state, state, currentTime);
+            setClickCount(pinInfo, 0); // Reset click count
+          } else {
+            // Interval too long, treat as two single presses
+            emitPinEvents(pinInfo, eventBit(EVENT_SINGLE_PRESS), state, state, currentTime);
+            setClickCount(pinInfo, 1); // Keep current click as first click
+          }
+        } else if (pinInfo->clickCount == 1) {
+          // If no double press callback is set, or no second click after timeout, trigger single press event
+          if (!(pinInfo->subscribed & eventBit(EVENT_DOUBLE_PRESS))) {
+            // No double press callback, directly trigger single press event
+            emitPinEvents(pinInfo, eventBit(EVENT_SINGLE_PRESS), state, state, currentTime);
+            setClickCount(pinInfo, 0); // Reset click count
+          } else if (pinInfo->speculativeSingle) {
+            // Speculative mode: trigger single press event now, retracted if a second click follows
+            emitPinEvents(pinInfo, eventBit(EVENT_SINGLE_PRESS), state, state, currentTime);
+          }
+          // If double press callback is set, don't immediately trigger single press event, wait for possible second click
+          // Single press event will only be triggered after timeout, this logic is handled in the timeout check below
+        }
+        
+        // Update last click time
+        pinInfo->lastClickTime = now;
+      } else if (pressDuration > profile.maxPressMs) {
+        // Press duration too long, not considered a valid click
+        setClickCount(pinInfo, 0);
+      } else if (pinInfo->clickCount > 0) {
+        // Press too short: take back its click, a pending click still times out as a single press
+        setClickCount(pinInfo, pinInfo->clickCount - 1);
+      }
+
+      // The press has been evaluated
+      pinInfo->pressActive = false;
+    }
+  }
+  
+  // Check for single press timeout (when button is released)
+  if (pinInfo->currentState == PIN_HIGH && pinInfo->clickCount == 1 && 
+      (pinInfo->subscribed & eventBit(EVENT_DOUBLE_PRESS)) && !pinInfo->pressActive) {
+    // If waited longer than maximum interval time, trigger single press event
+    if ((uint16_t)(now - pinInfo->lastClickTime) > profile.maxIntervalMs) {
+      // Already emitted on release in speculative mode
+      if (!pinInfo->speculativeSingle) {
+        emitPinEvents(pinInfo, eventBit(EVENT_SINGLE_PRESS), state, state, currentTime);
+      }
+      setClickCount(pinInfo, 0); // Reset click count
+    }
+  }
+}
+
+// Quadrature step of an A/B transition, indexed by (previous state << 2) | new state.
+// Invalid transitions (both pins changed, e.g. a missed reading) count as no step.
+static const int8_t QUADRATURE_STEPS[16] = {
+   0, -1,  1,  0,
+   1,  0,  0, -1,
+  -1,  0,  0,  1,
+   0,  1, -1,  0
+};
+
+// Decode the rotary encoders whose pins were just read (timerPass: timer-sampled pins)
+void AvantDigitalRead::decodeEncoders(unsigned long currentTime, bool timerPass) {
+  for (auto& encoder : encoders) {
+    // lastState holds the raw reading processReading() just saw
+    PinInfo* pinA = resolvePin(encoder.handleA);
+    PinInfo* pinB = resolvePin(encoder.handleB);
+    if (pinA == nullptr || pinB == nullptr || pinA->timerSampled != timerPass) {
+      continue;
+    }
+    uint8_t state = (uint8_t)((pinA->lastState << 1) | pinB->lastState);
+    if (state == encoder.state) {
+      continue;
+    }
+    encoder.steps += QUADRATURE_STEPS[(encoder.state << 2) | state];
+    encoder.state = state;
+    
+    // A 4-step encoder counts a detent when it comes to rest, so contact bounce and a
+    // missed step cannot shift the count; others count every stepsPerDetent steps
+    int direction = 0;
+    if (encoder.stepsPerDetent == 4) {
+      if (state == encoder.restState) {
+        direction = encoder.steps >= 2 ? 1 : (encoder.steps <= -2 ? -1 : 0);
+        encoder.steps = 0;
+      }
+    } else if (encoder.steps >= encoder.stepsPerDetent) {
+      direction = 1;
+      encoder.steps -= encoder.stepsPerDetent;
+    } else if (encoder.steps <= -encoder.stepsPerDetent) {
+      direction = -1;
+      encoder.steps += encoder.stepsPerDetent;
+    }
+    if (direction == 0) {
+      continue;
+    }
+    
+    // Acceleration: the faster the detents follow each other in one direction, the larger the step
+    long step = 1;
+    unsigned long interval = currentTime - encoder.lastDetentTime;
+    if (encoder.maxStep > 1 && direction == encoder.lastDirection && interval < encoder.accelerationMs) {
+      step += (long)(encoder.maxStep - 1) * (long)(encoder.accelerationMs - interval) / encoder.accelerationMs;
+    }
+    encoder.position += direction * step;
+    encoder.lastDetentTime = currentTime;
+    encoder.lastDirection = (int8_t)direction;
+    
+    if (pinA->eventsEnabled && encoder.callback != nullptr) {
+      EventTiming timing = {readingTimeUs, readingTimeUs};
+      PinState newState = direction > 0 ? PIN_HIGH : PIN_LOW;
+      emitEvent(encoder.callback, pinA->pin, newState, direction > 0 ? PIN_LOW : PIN_HIGH,
+                EVENT_ENCODER, currentTime, 0, false, timing);
+    }
+  }
+}
+
+// Add an encoder on two pins already in the table
+void AvantDigitalRead::addEncoderToTable(PinHandle handleA, PinHandle handleB, PinCallback callback,
+                                         uint8_t stepsPerDetent, int mode) {
+  EncoderInfo encoder;
+  encoder.handleA = handleA;
+  encoder.handleB = handleB;
+  encoder.callback = callback;
+  encoder.position = 0;
+  encoder.lastDetentTime = 0;
+  encoder.accelerationMs = 0;
+  encoder.maxStep = 1;
+  encoder.stepsPerDetent = stepsPerDetent;
+  // Detents of a standard encoder leave both contacts open, so both pins rest at their pull
+  // level. Fixed rather than read now: the encoder may be between detents, or the pins not
+  // settled yet after pinMode().
+  encoder.restState = 3;
+#ifdef INPUT_PULLDOWN
+  if (mode == INPUT_PULLDOWN) {
+    encoder.restState = 0;
+  }
+#else
+  (void)mode;
+#endif
+  encoder.state = encoder.restState;
+  encoder.steps = 0;
+  encoder.lastDirection = 0;
+  encoders.push_back(encoder);
+}
+
+// Remove an encoder and its two pins
+void AvantDigitalRead::removeEncoderFromTable(PinHandle handleA) {
+  for (auto& encoder : encoders) {
+    if (encoder.handleA == handleA) {
+      // freePin() erases the encoder: take what is needed first
+      PinHandle handleB = encoder.handleB;
+      PinInfo* pinA = resolvePin(handleA);
+      PinInfo* pinB = resolvePin(handleB);
+      if (pinA != nullptr) {
+        freePin(pinA);
+      }
+      if (pinB != nullptr) {
+        freePin(pinB);
+      }
+      return;
+    }
+  }
+}
+
+// Find the encoder whose pin A is pin
+EncoderInfo* AvantDigitalRead::findEncoder(int pinA) {
+  PinHandle handle = pinHandle(pinA);
+  if (!handle) {
+    return nullptr;
+  }
+  for (auto& encoder : encoders) {
+    if (encoder.handleA == handle) {
+      return &encoder;
+    }
+  }
+  return nullptr;
+}
+
+// Count a debounced edge of a pin in pulse counter mode
+void AvantDigitalRead::countPulse(PinInfo& pinInfo, PinState newState) {
+  PinHandle handle = handleOf(&pinInfo);
+  for (auto& counter : counters) {
+    if (counter.handle != handle) {
+      continue;
+    }
+    if (counter.edges != EVENT_CHANGE && (counter.edges == EVENT_RISING) != (newState == PIN_HIGH)) {
+      return;
+    }
+    
+    // Timed by the first raw edge, so debounce and loop delays do not skew the period
+    uint32_t timeUs = pinInfo.edgeTimeUs;
+    if (counter.total == 0) {
+      counter.spanStartUs = timeUs;
+      counter.spanPeriods = 0;
+    } else {
+      counter.periodUs = timeUs - counter.lastPulseUs;
+      counter.spanPeriods++;
+    }
+    counter.lastPulseUs = timeUs;
+    counter.total++;
+    counter.windowPulses++;
+    return;
+  }
+}
+
+// End the rate windows that are over (timerPass: counters of timer-sampled pins)
+void AvantDigitalRead::updateCounters(unsigned long currentTime, bool timerPass) {
+  for (size_t i = 0; i < counters.size(); i++) {
+    PulseCounter& counter = counters[i];
+    // Each counter follows the clock its pin is read with: the timer's sample clock or the pass time
+    PinInfo* pinInfo = resolvePin(counter.handle);
+    if (pinInfo == nullptr || pinInfo->timerSampled != timerPass) {
+      continue;
+    }
+    if (!counter.windowStarted) {
+      // First pass: start the window in the time base of the pass (millis(), sample clock or VCD time)
+      counter.windowStart = currentTime;
+      counter.windowStarted = true;
+      continue;
+    }
+    // A pass timed before the window start (clocks slightly apart) counts as no time elapsed
+    long elapsed = (long)(currentTime - counter.windowStart);
+    if (elapsed < (long)counter.windowMs) {
+      continue;
+    }
+    counter.rate = counter.windowPulses * 1000.0f / elapsed;
+    counter.windowPulses = 0;
+    counter.windowStart = currentTime;
+    // The next average starts at the last edge, keeping the period that spans the boundary
+    counter.spanStartUs = counter.lastPulseUs;
+    counter.spanPeriods = 0;
+    
+    if (counter.callback != nullptr && pinInfo->eventsEnabled) {
+      EventTiming timing = {readingTimeUs, readingTimeUs};
+      PinState state = (PinState)pinInfo->currentState;
+      emitEvent(counter.callback, pinInfo->pin, state, state, EVENT_PULSE_REPORT, currentTime, 0, false, timing);
+    }
+  }
+}
+
+// Start (enabled) or stop counting the edges of a pin
+void AvantDigitalRead::applyCounter(PinInfo* pinInfo, bool enabled, EventType edges, unsigned long windowMs,
+                                    PinCallback callback) {
+  PinHandle handle = handleOf(pinInfo);
+  for (size_t i = 0; i < counters.size(); i++) {
+    if (counters[i].handle == handle) {
+      if (!enabled) {
+        counters.erase(counters.begin() + i);
+        return;
+      }
+      // Reconfigure, keeping the count
+      counters[i].edges = edges;
+      counters[i].windowMs = windowMs;
+      counters[i].callback = callback;
+      return;
+    }
+  }
+  if (!enabled) {
+    return;
+  }
+  
+  PulseCounter counter;
+  counter.handle = handle;
+  counter.callback = callback;
+  counter.total = 0;
+  counter.windowStart = 0;
+  counter.windowStarted = false;
+  counter.windowMs = windowMs;
+  counter.windowPulses = 0;
+  counter.spanStartUs = 0;
+  counter.spanPeriods = 0;
+  counter.lastPulseUs = 0;
+  counter.periodUs = 0;
+  counter.rate = 0;
+  counter.edges = edges;
+  counters.push_back(counter);
+}
+
+// Find the pulse counter of a pin
+PulseCounter* AvantDigitalRead::findCounter(int pin) {
+  PinHandle handle = pinHandle(pin);
+  if (!handle) {
+    return nullptr;
+  }
+  for (auto& counter : counters) {
+    if (counter.handle == handle) {
+      return &counter;
+    }
+  }
+  return nullptr;
+}
+
+// Set the clicks of the pending gesture of a pin (traced at TRACE_LEVEL_PINS)
+void AvantDigitalRead::setClickCount(PinInfo* pinInfo, uint8_t clickCount) {
+  if (pinInfo->clickCount != clickCount) {
+    AVANT_TRACE(TRACE_LEVEL_PINS, TRACE_CLICK_STATE, pinInfo->pin, EVENT_CHANGE, readingTimeUs, clickCount);
+  }
+  pinInfo->clickCount = clickCount;
+}
+
+// Add pin
+PinHandle AvantDigitalRead::addPin(int pin, int mode) {
+  // Pin numbers are stored in one byte
+  if (pin < 0 || pin > 255) {
+    return PinHandle();
+  }
+  
+  if (deferChanges()) {
+    // Reserve the slot now so the caller gets a handle that will be valid after the next pass
+    bool otherTask = otherTasksActive();
+    PinHandle handle;
+    lockChanges();
+    size_t slot = predictSlot();
+    // From another task the table must not move: only the free capacity can be used
+    if (!pendingHandle(pin) && (!otherTask || slot < pinList.capacity())) {
+      uint16_t generation = (uint16_t)(slotWord(slot) >> 16);
+      handle = PinHandle(((uint32_t)generation << 16) | (uint32_t)(slot + 1));
+      PendingPinChange change = pinChange(PIN_CHANGE_ADD, handle);
+      change.pin = pin;
+      change.mode = mode;
+      pendingChanges.push_back(change);
+      changesPending.store(true, std::memory_order_release);
+    }
+    unlockChanges();
+    return handle;
+  }
+  
+  // Check if pin is already initialized
+  applyPendingChanges();
+  if (findPin(pin) != nullptr) {
+    return PinHandle();
+  }
+  return addPinToSlot(pin, mode, predictSlot());
+}
+
+// Add a pin in a given slot
+PinHandle AvantDigitalRead::addPinToSlot(int pin, int mode, size_t slot) {
+  if (slot >= (size_t)MAX_PIN_SLOTS || findPin(pin) != nullptr || (slot < pinList.size() && pinList[slot].inUse)) {
+    return PinHandle();
+  }
+  
+  // Initialize pin
+  pinMode(pin, mode);
+  
+  // Slots of removed pins are reused, so handles and slot indexes stay small
+  while (slot >= pinList.size()) {
+    PinInfo unused;
+    unused.inUse = false;
+    unused.generation = 0;
+    pinList.push_back(unused);
+    pinHandlers.push_back(std::vector<PinHandler>());
+  }
+  
+  // Create new pin information
+  PinInfo& newPin = pinList[slot];
+  newPin.pin = (uint8_t)pin;
+  newPin.mode = (uint8_t)mode;
+  newPin.currentState = digitalRead(pin) == HIGH ? PIN_HIGH : PIN_LOW;
+  newPin.lastState = newPin.currentState;
+  newPin.lastDebounceTime = 0;
+  newPin.edgeTimeUs = 0;
+  newPin.eventsEnabled = true;
+  
+  // No event handlers yet
+  newPin.subscribed = 0;
+  newPin.throttle = 0;
+  
+  // Debounce time and button parameters come from the default profile
+  newPin.profile = 0;
+  profiles[0].pinCount++;
+  
+  // Initialize button state tracking
+  newPin.pressStartTime = 0;
+  newPin.lastClickTime = 0;  // Add initialization for last click time
+  newPin.clickCount = 0;
+  newPin.longPressTriggered = false;
+  newPin.pressActive = false;
+  newPin.timerSampled = false;
+  newPin.replacePending = false;
+  newPin.speculativeSingle = false;
+  
+  // Set last, so another task never sees a half-initialized pin
+  newPin.inUse = true;
+  setLevel(&newPin, newPin.currentState == PIN_HIGH);
+  publishSnapshot(&newPin);
+  
+  return handleOf(&newPin);
+}
+
+// Remove pin
+bool AvantDigitalRead::removePin(PinHandle handle) {
+  if (deferChanges()) {
+    if (!handle) {
+      return false;
+    }
+    PendingPinChange change = pinChange(PIN_CHANGE_REMOVE, handle);
+    queueChange(change);
+    return true;
+  }
+  applyPendingChanges();
+  PinInfo* pinInfo = resolvePin(handle);
+  if (pinInfo == nullptr) {
+    return false;
+  }
+  freePin(pinInfo);
+  return true;
+}
+
+// Take a pin out of the table
+void AvantDigitalRead::freePin(PinInfo* pinInfo) {
+  // Free the slot; the new generation makes existing handles stale
+  profiles[pinInfo->profile].pinCount--;
+  handlersOf(pinInfo).clear();
+  pinInfo->subscribed = 0;
+  applyThrottle(pinInfo, THROTTLE_NONE, 0, 0);
+  dropPendingCallbacks(pinInfo->pin, true);
+  
+  // An encoder cannot work without either of its pins
+  PinHandle handle = handleOf(pinInfo);
+  
+  // The timer keeps reading the pin (the bit layout of its samples is fixed), but its samples are
+  // no longer processed, also not for a pin added again with the same number
+  for (auto& timerPin : timerPins) {
+    if (timerPin.handle == handle) {
+      timerPin.handle = PinHandle();
+    }
+  }
+  applyCounter(pinInfo, false, EVENT_RISING, 0, nullptr);
+  for (size_t i = encoders.size(); i-- > 0;) {
+    if (encoders[i].handleA == handle || encoders[i].handleB == handle) {
+      encoders.erase(encoders.begin() + i);
+    }
+  }
+  pinInfo->inUse = false;
+  pinInfo->generation++;
+  setLevel(pinInfo, false);
+  publishSnapshot(pinInfo);
+}
+
+// Remove pin by pin number
+bool AvantDigitalRead::removePin(int pin) {
+  return removePin(pinHandle(pin));
+}
+
+// Check if a handle refers to a pin that has not been removed
+bool AvantDigitalRead::isInitialized(PinHandle handle) {
+  return resolvePin(handle) != nullptr;
+}
+
+// Check if pin is initialized
+bool AvantDigitalRead::isInitialized(int pin) {
+  return findPin(pin) != nullptr;
+}
+
+// Get the handle of an initialized pin (invalid handle if there is none)
+PinHandle AvantDigitalRead::pinHandle(int pin) {
+  if (!deferChanges()) {
+    applyPendingChanges();
+  }
+  // From another task pinList may be changing: the published snapshot has the same pins
+  if (!changesPending.load(std::memory_order_acquire)) {
+    return otherTasksActive() ? publishedHandle(pin) : handleOf(findPin(pin));
+  }
+  // Pins added or removed by queued changes count as already added or removed
+  lockChanges();
+  PinHandle handle = pendingHandle(pin);
+  unlockChanges();
+  return handle;
+}
+
+// Copy the levels of all pins published at the end of the last pass
+uint32_t AvantDigitalRead::readAll(uint64_t* mask) {
+  uint32_t words[PIN_SNAPSHOT_WORDS * 2];
+  uint32_t before;
+  uint32_t after;
+  do {
+    before = snapshotSequence.load(std::memory_order_acquire);
+    for (int i = 0; i < PIN_SNAPSHOT_WORDS * 2; i++) {
+      words[i] = publishedLevels[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = snapshotSequence.load(std::memory_order_relaxed);
+    // Retry if the sampling side published while the words were copied
+  } while ((before & 1) || before != after);
+  
+  if (mask != nullptr) {
+    for (int i = 0; i < PIN_SNAPSHOT_WORDS; i++) {
+      mask[i] = ((uint64_t)words[i * 2 + 1] << 32) | words[i * 2];
+    }
+  }
+  return before / 2;
+}
+
+// Edge and acceptance time of the event whose callback is running
+const EventTiming& AvantDigitalRead::getEventTiming() {
+  return callbackTiming;
+}
+
+// Get pin mode
+int AvantDigitalRead::getPinMode(PinHandle handle) {
+  PinInfo* pinInfo = resolvePin(handle);
+  if (pinInfo == nullptr) {
+    return PIN_UNINITIALIZED;
+  }
+  return pinInfo->mode;
+}
+
+// Get pin mode by pin number
+int AvantDigitalRead::getPinMode(int pin) {
+  return getPinMode(pinHandle(pin));
+}
+
+// Read pin state
+PinState AvantDigitalRead::readPin(PinHandle handle) {
+  // update() may be changing the pin table in another task: use the last published snapshot
+  if (otherTasksActive()) {
+    size_t slot = (handle.value & 0xFFFF) - 1;
+    if (slot >= (size_t)MAX_PIN_SLOTS) {
+      return PIN_UNINITIALIZED;
+    }
+    uint32_t slotBits;
+    uint32_t levels;
+    uint32_t before;
+    do {
+      before = snapshotSequence.load(std::memory_order_acquire);
+      slotBits = publishedSlots[slot].load(std::memory_order_relaxed);
+      levels = publishedLevels[(slotBits & 0xFF) >> 5].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((before & 1) || before != snapshotSequence.load(std::memory_order_relaxed));
+    if (!(slotBits & SLOT_IN_USE) || (slotBits >> 16) != (handle.value >> 16)) {
+      return PIN_UNINITIALIZED;
+    }
+    return (levels >> (slotBits & 31)) & 1 ? PIN_HIGH : PIN_LOW;
+  }
+  PinInfo* pinInfo = resolvePin(handle);
+  if (pinInfo == nullptr) {
+    return PIN_UNINITIALIZED;
+  }
+  return (PinState)pinInfo->currentState;
+}
+
+// Read pin state by pin number
+PinState AvantDigitalRead::readPin(int pin) {
+  // From another task: the published snapshot, without searching or locking
+  if (otherTasksActive()) {
+    if (pin < 0 || pin >= MAX_PIN_SLOTS) {
+      return PIN_UNINITIALIZED;
+    }
+    uint32_t pins;
+    uint32_t levels;
+    uint32_t before;
+    do {
+      before = snapshotSequence.load(std::memory_order_acquire);
+      pins = publishedPins[pin >> 5].load(std::memory_order_relaxed);
+      levels = publishedLevels[pin >> 5].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((before & 1) || before != snapshotSequence.load(std::memory_order_relaxed));
+    if (!((pins >> (pin & 31)) & 1)) {
+      return PIN_UNINITIALIZED;
+    }
+    return (levels >> (pin & 31)) & 1 ? PIN_HIGH : PIN_LOW;
+  }
+  return readPin(pinHandle(pin));
+}
+
+// Set debounce time
+bool AvantDigitalRead::setDebounceTime(PinHandle handle, unsigned long debounceMs) {
+  if (!validTiming(debounceMs)) {
+    return false;
+  }
+  GestureProfile values = {};
+  values.debounceTime = (uint16_t)debounceMs;
+  return changeTiming(handle, values, TIMING_DEBOUNCE);
+}
+
+// Set debounce time by pin number
+bool AvantDigitalRead::setDebounceTime(int pin, unsigned long debounceMs) {
+  return setDebounceTime(pinHandle(pin), debounceMs);
+}
+
+// Get debounce time
+unsigned long AvantDigitalRead::getDebounceTime(PinHandle handle) {
+  PinInfo* pinInfo = resolvePin(handle);
+  if (pinInfo == nullptr) {
+    return DEFAULT_DEBOUNCE_TIME; // Return default value
+  }
+  return profiles[pinInfo->profile].debounceTime;
+}
+
+// Get debounce time by pin number
+unsigned long AvantDigitalRead::getDebounceTime(int pin) {
+  return getDebounceTime(pinHandle(pin));
+}
+
+// Set state change callback
+bool AvantDigitalRead::onChange(PinHandle handle, PinCallback callback, unsigned long delayMs) {
+  return changeHandler(handle, EVENT_CHANGE, callback, delayMs);
+}
+
+// Set state change callback by pin number
+bool AvantDigitalRead::onChange(int pin, PinCallback callback, unsigned long delayMs) {
+  return onChange(pinHandle(pin), callback, delayMs);
+}
+
+// Set rising edge callback
+bool AvantDigitalRead::onRising(PinHandle handle, PinCallback callback, unsigned long delayMs) {
+  return changeHandler(handle, EVENT_RISING, callback, delayMs);
+}
+
+// Set rising edge callback by pin number
+bool AvantDigitalRead::onRising(int pin, PinCallback callback, unsigned long delayMs) {
+  return onRising(pinHandle(pin), callback, delayMs);
+}
+
+// Set falling edge callback
+bool AvantDigitalRead::onFalling(PinHandle handle, PinCallback callback, unsigned long delayMs) {
+  return changeHandler(handle, EVENT_FALLING, callback, delayMs);
+}
+
+// Set falling edge callback by pin number
+bool AvantDigitalRead::onFalling(int pin, PinCallback callback, unsigned long delayMs) {
+  return onFalling(pinHandle(pin), callback, delayMs);
+}
+
+// Set single press callback
+bool AvantDigitalRead::onSinglePress(PinHandle handle, PinCallback callback, unsigned long delayMs) {
+  return changeHandler(handle, EVENT_SINGLE_PRESS, callback, delayMs);
+}
+
+// Set single press callback by pin number
+bool AvantDigitalRead::onSinglePress(int pin, PinCallback callback, unsigned long delayMs) {
+  return onSinglePress(pinHandle(pin), callback, delayMs);
+}
+
+// Set click parameters
+bool AvantDigitalRead::setClickParameters(PinHandle handle, unsigned long minPressMs, unsigned long maxPressMs) {
+  if (!validTiming(minPressMs) || !validTiming(maxPressMs)) {
+    return false;
+  }
+  GestureProfile values = {};
+  values.minPressMs = (uint16_t)minPressMs;
+  values.maxPressMs = (uint16_t)maxPressMs;
+  return changeTiming(handle, values, TIMING_CLICK);
+}
+
+// Set click parameters by pin number
+bool AvantDigitalRead::setClickParameters(int pin, unsigned long minPressMs, unsigned long maxPressMs) {
+  return setClickParameters(pinHandle(pin), minPressMs, maxPressMs);
+}
+
+// Set double press callback
+bool AvantDigitalRead::onDoublePress(PinHandle handle, PinCallback callback, unsigned long delayMs, unsigned long maxIntervalMs) {
+  // Checked first, so a rejected call changes nothing
+  if (!validTiming(maxIntervalMs) || !changeHandler(handle, EVENT_DOUBLE_PRESS, callback, delayMs)) {
+    return false;
+  }
+  GestureProfile values = {};
+  values.maxIntervalMs = (uint16_t)maxIntervalMs;
+  return changeTiming(handle, values, TIMING_INTERVAL);
+}
+
+// Set double press callback by pin number
+bool AvantDigitalRead::onDoublePress(int pin, PinCallback callback, unsigned long delayMs, unsigned long maxIntervalMs) {
+  return onDoublePress(pinHandle(pin), callback, delayMs, maxIntervalMs);
+}
+
+// Set long press callback
+bool AvantDigitalRead::onLongPress(PinHandle handle, PinCallback callback, unsigned long delayMs, unsigned long pressDurationMs, bool repeat) {
+  // Checked first, so a rejected call changes nothing
+  if (!validTiming(pressDurationMs) || !changeHandler(handle, EVENT_LONG_PRESS, callback, delayMs)) {
+    return false;
+  }
+  GestureProfile values = {};
+  values.pressDurationMs = (uint16_t)pressDurationMs;
+  values.repeatLongPress = repeat;
+  return changeTiming(handle, values, TIMING_LONG_PRESS);
+}
+
+// Set long press callback by pin number
+bool AvantDigitalRead::onLongPress(int pin, PinCallback callback, unsigned long delayMs, unsigned long pressDurationMs, bool repeat) {
+  return onLongPress(pinHandle(pin), callback, delayMs, pressDurationMs, repeat);
+}
+
+// Emit single presses without waiting for the double press window
+bool AvantDigitalRead::setSpeculativeSinglePress(PinHandle handle, bool enabled) {
+  if (deferChanges()) {
+    if (!handle) {
+      return false;
+    }
+    PendingPinChange change = pinChange(PIN_CHANGE_SPECULATIVE, handle);
+    change.enabled = enabled;
+    queueChange(change);
+    return true;
+  }
+  applyPendingChanges();
+  PinInfo* pinInfo = resolvePin(handle);
+  if (pinInfo == nullptr) {
+    return false;
+  }
+  pinInfo->speculativeSingle = enabled;
+  return true;
+}
+
+// Emit single presses without waiting for the double press window by pin number
+bool AvantDigitalRead::setSpeculativeSinglePress(int pin, bool enabled) {
+  return setSpeculativeSinglePress(pinHandle(pin), enabled);
+}
+
+// Subscribe a callback to an event of a pin, next to any existing subscribers
+SubscriptionToken AvantDigitalRead::subscribe(PinHandle handle, EventType event, PinCallback callback, unsigned long delayMs) {
+  return addSubscription(handle, event, callback, delayMs, false);
+}
+
+// Subscribe a handler (replacePending: retriggerable timer)
+SubscriptionToken AvantDigitalRead::addSubscription(PinHandle handle, EventType event, PinCallback callback,
+                                                    unsigned long delayMs, bool replacePending) {
+  if (callback == nullptr || (int)event < 0 || (int)event >= EVENT_TYPE_COUNT) {
+    return 0;
+  }
+  if (deferChanges()) {
+    if (!handle) {
+      return 0;
+    }
+    // The token is handed out now; the handler is added at the next pass
+    lockChanges();
+    PendingPinChange change = pinChange(PIN_CHANGE_SUBSCRIBE, handle);
+    change.event = event;
+    change.callback = callback;
+    change.delayMs = delayMs;
+    change.token = nextToken;
+    change.enabled = replacePending;
+    if (++nextToken == 0) {
+      nextToken = 1;
+    }
+    pendingChanges.push_back(change);
+    changesPending.store(true, std::memory_order_release);
+    unlockChanges();
+    return change.token;
+  }
+  applyPendingChanges();
+  PinInfo* pinInfo = resolvePin(handle);
+  if (pinInfo == nullptr) {
+    return 0;
+  }
+  PinHandler handler = {callback, delayMs, nextToken, event, replacePending};
+  if (++nextToken == 0) {
+    nextToken = 1;
+  }
+  addHandler(pinInfo, handler);
+  return handler.token;
+}
+
+// Subscribe a callback to an event of a pin by pin number
+SubscriptionToken AvantDigitalRead::subscribe(int pin, EventType event, PinCallback callback, unsigned long delayMs) {
+  return subscribe(pinHandle(pin), event, callback, delayMs);
+}
+
+// Remove a subscription made with subscribe()
+bool AvantDigitalRead::unsubscribe(SubscriptionToken token) {
+  if (token == 0) {
+    return false;
+  }
+  if (deferChanges()) {
+    PendingPinChange change = pinChange(PIN_CHANGE_UNSUBSCRIBE, PinHandle());
+    change.token = token;
+    queueChange(change);
+    return true;
+  }
+  applyPendingChanges();
+  return removeSubscription(token);
+}
+
+// Remove a subscribe() handler
+bool AvantDigitalRead::removeSubscription(SubscriptionToken token) {
+  for (auto& pinInfo : pinList) {
+    if (!pinInfo.inUse) {
+      continue;
+    }
+    std::vector<PinHandler>& handlers = handlersOf(&pinInfo);
+    for (size_t i = 0; i < handlers.size(); i++) {
+      if (handlers[i].token == token) {
+        removeHandler(&pinInfo, i);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Pre-size the handler array of a pin so later subscriptions do not allocate
+bool AvantDigitalRead::reserveSubscribers(PinHandle handle, size_t count) {
+  if (deferChanges()) {
+    if (!handle) {
+      return false;
+    }
+    PendingPinChange change = pinChange(PIN_CHANGE_RESERVE, handle);
+    change.count = count;
+    queueChange(change);
+    return true;
+  }
+  applyPendingChanges();
+  PinInfo* pinInfo = resolvePin(handle);
+  if (pinInfo == nullptr) {
+    return false;
+  }
+  handlersOf(pinInfo).reserve(count);
+  return true;
+}
+
+// Pre-size the handler array of a pin by pin number
+bool AvantDigitalRead::reserveSubscribers(int pin, size_t count) {
+  return reserveSubscribers(pinHandle(pin), count);
+}
+
+// Always queue pin changes for the next pass (for update() running in another task)
+void AvantDigitalRead::setDeferredReconfiguration(bool enabled) {
+  if (enabled && !deferredReconfiguration) {
+    applyPendingChanges();
+    reservePinHeadroom();
+  }
+  deferredReconfiguration = enabled;
+}
+
+// Number of pin changes waiting for the next pass
+size_t AvantDigitalRead::getPendingChanges() {
+  lockChanges();
+  size_t count = pendingChanges.size();
+  unlockChanges();
+  return count;
+}
+
+// Limit the edge events of a pin
+bool AvantDigitalRead::setThrottle(PinHandle handle, ThrottlePolicy policy, unsigned long windowMs, uint8_t maxEvents) {
+  if ((int)policy < THROTTLE_NONE || (int)policy > THROTTLE_TRAILING || !validTiming(windowMs)) {
+    return false;
+  }
+  if (deferChanges()) {
+    if (!handle) {
+      return false;
+    }
+    PendingPinChange change = pinChange(PIN_CHANGE_THROTTLE, handle);
+    change.delayMs = windowMs;
+    change.count = maxEvents;
+    change.policy = policy;
+    queueChange(change);
+    return true;
+  }
+  applyPendingChanges();
+  PinInfo* pinInfo = resolvePin(handle);
+  if (pinInfo == nullptr) {
+    return false;
+  }
+  return applyThrottle(pinInfo, policy, windowMs, maxEvents);
+}
+
+// Limit the edge events of a pin by pin number
+bool AvantDigitalRead::setThrottle(int pin, ThrottlePolicy policy, unsigned long windowMs, uint8_t maxEvents) {
+  return setThrottle(pinHandle(pin), policy, windowMs, maxEvents);
+}
+
+// Number of transitions of a pin that did not get their own event because of its throttle
+unsigned long AvantDigitalRead::getSuppressedEvents(PinHandle handle) {
+  PinInfo* pinInfo = resolvePin(handle);
+  if (pinInfo == nullptr || pinInfo->throttle == 0) {
+    return 0;
+  }
+  return throttles[pinInfo->throttle - 1].suppressed;
+}
+
+// Number of suppressed transitions by pin number
+unsigned long AvantDigitalRead::getSuppressedEvents(int pin) {
+  return getSuppressedEvents(pinHandle(pin));
+}
+
+// Let a new delayed event replace the one still pending for the same handler
+bool AvantDigitalRead::setReplacePending(PinHandle handle, bool enabled) {
+  if (deferChanges()) {
+    if (!handle) {
+      return false;
+    }
+    PendingPinChange change = pinChange(PIN_CHANGE_REPLACE_PENDING, handle);
+    change.enabled = enabled;
+    queueChange(change);
+    return true;
+  }
+  applyPendingChanges();
+  PinInfo* pinInfo = resolvePin(handle);
+  if (pinInfo == nullptr) {
+    return false;
+  }
+  pinInfo->replacePending = enabled;
+  return true;
+}
+
+// Let a new delayed event replace the pending one by pin number
+bool AvantDigitalRead::setReplacePending(int pin, bool enabled) {
+  return setReplacePending(pinHandle(pin), enabled);
+}
+
+// Handle of the latest pending delayed call of a pin's event (0 if there is none)
+CallbackHandle AvantDigitalRead::getPendingCallback(int pin, EventType event) {
+  CallbackHandle handle = 0;
+  unsigned long latest = 0;
+  for (size_t slot = 0; slot < delayedCallbacks.size(); slot++) {
+    const DelayedCallback& delayedCb = delayedCallbacks[slot];
+    if (!delayedCb.executed && delayedCb.pin == pin && delayedCb.event == event &&
+        (handle == 0 || (long)(delayedCb.timestamp - latest) >= 0)) {
+      handle = ((uint32_t)delayedCb.generation << 16) | (uint32_t)(slot + 1);
+      latest = delayedCb.timestamp;
+    }
+  }
+  return handle;
+}
+
+// Cancel a pending delayed call
+bool AvantDigitalRead::cancel(CallbackHandle handle) {
+  size_t slot = (handle & 0xFFFF);
+  if (slot == 0 || slot > delayedCallbacks.size()) {
+    return false;
+  }
+  slot--;
+  DelayedCallback& delayedCb = delayedCallbacks[slot];
+  if (delayedCb.executed || delayedCb.generation != (uint16_t)(handle >> 16)) {
+    return false;
+  }
+  AVANT_TRACE(TRACE_LEVEL_CALLBACKS, TRACE_DELAYED_CANCELLED, delayedCb.pin, delayedCb.event,
+              (uint32_t)(delayedCb.timestamp + delayedCb.delayMs) * 1000u, 0);
+  releaseDelayed(slot);
+  return true;
+}
+
+// Cancel all pending delayed calls of a pin, returns how many were cancelled
+size_t AvantDigitalRead::cancelAll(int pin) {
+  return cancelPending(pin, true);
+}
+
+// Cancel the pending delayed calls of a pin (timers: also its startTimer() timers)
+size_t AvantDigitalRead::cancelPending(int pin, bool timers) {
+  size_t cancelled = 0;
+  for (size_t slot = 0; slot < delayedCallbacks.size() && pendingDelayed != 0; slot++) {
+    if (!delayedCallbacks[slot].executed && delayedCallbacks[slot].pin == pin &&
+        (timers || delayedCallbacks[slot].event != EVENT_TIMER)) {
+      AVANT_TRACE(TRACE_LEVEL_CALLBACKS, TRACE_DELAYED_CANCELLED, pin, delayedCallbacks[slot].event,
+                  (uint32_t)(delayedCallbacks[slot].timestamp + delayedCallbacks[slot].delayMs) * 1000u, 0);
+      releaseDelayed(slot);
+      cancelled++;
+    }
+  }
+  return cancelled;
+}
+
+// Number of delayed calls waiting to run
+size_t AvantDigitalRead::getPendingCallbacks() {
+  return pendingDelayed;
+}
+
+// Start a one-shot (periodMs 0) or periodic timer that calls back with EVENT_TIMER
+CallbackHandle AvantDigitalRead::startTimer(int pin, PinCallback callback, unsigned long delayMs, unsigned long periodMs) {
+  if (callback == nullptr) {
+    return 0;
+  }
+  DelayedCallback timer;
+  timer.callback = callback;
+  timer.pin = pin;
+  timer.newState = PIN_UNINITIALIZED;
+  timer.oldState = PIN_UNINITIALIZED;
+  timer.event = EVENT_TIMER;
+  timer.timestamp = millis();
+  timer.delayMs = delayMs;
+  timer.periodMs = periodMs;
+  timer.timing.edgeUs = (uint32_t)(timer.timestamp + delayMs) * 1000u;
+  timer.timing.acceptedUs = timer.timing.edgeUs;
+  if (pin >= 0 && pin < PIN_SNAPSHOT_WORDS * 64) {
+    uint32_t word = publishedLevels[pin >> 5].load(std::memory_order_acquire);
+    timer.newState = (word >> (pin & 31)) & 1 ? PIN_HIGH : PIN_LOW;
+    timer.oldState = timer.newState;
+  }
+  return scheduleDelayed(timer);
+}
+
+// Count the delay of a pending timer or delayed call again from now
+bool AvantDigitalRead::restartTimer(CallbackHandle handle) {
+  size_t slot = (handle & 0xFFFF);
+  if (slot == 0 || slot > delayedCallbacks.size()) {
+    return false;
+  }
+  slot--;
+  DelayedCallback& delayedCb = delayedCallbacks[slot];
+  if (delayedCb.executed || delayedCb.generation != (uint16_t)(handle >> 16)) {
+    return false;
+  }
+  delayedCb.timestamp = millis();
+  pushDue(slot);
+  return true;
+}
+
+// Call back timeoutMs after the last trigger event of a pin (each trigger restarts the wait)
+SubscriptionToken AvantDigitalRead::retriggerTimer(PinHandle handle, EventType trigger, PinCallback callback, unsigned long timeoutMs) {
+  if (timeoutMs == 0) {
+    return 0;
+  }
+  return addSubscription(handle, trigger, callback, timeoutMs, true);
+}
+
+// Retriggerable timer by pin number
+SubscriptionToken AvantDigitalRead::retriggerTimer(int pin, EventType trigger, PinCallback callback, unsigned long timeoutMs) {
+  return retriggerTimer(pinHandle(pin), trigger, callback, timeoutMs);
+}
+
+// Add a quadrature rotary encoder on two new pins, reported through callback with EVENT_ENCODER
+bool AvantDigitalRead::addEncoder(int pinA, int pinB, PinCallback callback, uint8_t stepsPerDetent, int mode) {
+  if (pinA == pinB || (stepsPerDetent != 1 && stepsPerDetent != 2 && stepsPerDetent != 4)) {
+    return false;
+  }
+  PinHandle handleA = addPin(pinA, mode);
+  if (!handleA) {
+    return false;
+  }
+  PinHandle handleB = addPin(pinB, mode);
+  if (!handleB) {
+    removePin(handleA);
+    return false;
+  }
+  
+  if (deferChanges()) {
+    // Queued after the two pin adds, so the pins exist when it is applied
+    PendingPinChange change = pinChange(PIN_CHANGE_ADD_ENCODER, handleA);
+    change.pin = pinA;
+    change.mode = mode;
+    change.event = EVENT_ENCODER;
+    change.callback = callback;
+    change.count = stepsPerDetent;
+    change.other = handleB;
+    queueChange(change);
+    return true;
+  }
+  addEncoderToTable(handleA, handleB, callback, stepsPerDetent, mode);
+  return true;
+}
+
+// Remove an encoder and its two pins
+bool AvantDigitalRead::removeEncoder(int pinA) {
+  if (deferChanges()) {
+    PinHandle handle = pinHandle(pinA);
+    if (!handle) {
+      return false;
+    }
+    PendingPinChange change = pinChange(PIN_CHANGE_REMOVE_ENCODER, handle);
+    change.event = EVENT_ENCODER;
+    queueChange(change);
+    return true;
+  }
+  applyPendingChanges();
+  if (findEncoder(pinA) == nullptr) {
+    return false;
+  }
+  removeEncoderFromTable(pinHandle(pinA));
+  return true;
+}
+
+// Get the position of an encoder (detents, scaled by acceleration)
+long AvantDigitalRead::getEncoderPosition(int pinA) {
+  EncoderInfo* encoder = findEncoder(pinA);
+  return encoder != nullptr ? encoder->position : 0;
+}
+
+// Set the position of an encoder
+bool AvantDigitalRead::setEncoderPosition(int pinA, long position) {
+  EncoderInfo* encoder = findEncoder(pinA);
+  if (encoder == nullptr) {
+    return false;
+  }
+  encoder->position = position;
+  return true;
+}
+
+// Let fast turns move an encoder by up to maxStep per detent (accelerationMs 0 or maxStep 1: off)
+bool AvantDigitalRead::setEncoderAcceleration(int pinA, unsigned long accelerationMs, uint8_t maxStep) {
+  EncoderInfo* encoder = findEncoder(pinA);
+  if (encoder == nullptr) {
+    return false;
+  }
+  encoder->accelerationMs = (uint16_t)(accelerationMs > MAX_PIN_TIMING_MS ? MAX_PIN_TIMING_MS : accelerationMs);
+  encoder->maxStep = maxStep == 0 ? 1 : maxStep;
+  return true;
+}
+
+// Count the edges of a pin without callbacks, optionally reporting each rate window through reportCallback
+bool AvantDigitalRead::setPulseCounter(PinHandle handle, EventType edges, unsigned long windowMs, PinCallback reportCallback) {
+  if ((edges != EVENT_CHANGE && edges != EVENT_RISING && edges != EVENT_FALLING) || windowMs == 0) {
+    return false;
+  }
+  if (deferChanges()) {
+    if (!handle) {
+      return false;
+    }
+    PendingPinChange change = pinChange(PIN_CHANGE_COUNTER, handle);
+    change.event = edges;
+    change.callback = reportCallback;
+    change.delayMs = windowMs;
+    change.enabled = true;
+    queueChange(change);
+    return true;
+  }
+  applyPendingChanges();
+  PinInfo* pinInfo = resolvePin(handle);
+  if (pinInfo == nullptr) {
+    return false;
+  }
+  applyCounter(pinInfo, true, edges, windowMs, reportCallback);
+  return true;
+}
+
+// Count the edges of a pin by pin number
+bool AvantDigitalRead::setPulseCounter(int pin, EventType edges, unsigned long windowMs, PinCallback reportCallback) {
+  return setPulseCounter(pinHandle(pin), edges, windowMs, reportCallback);
+}
+
+// Stop counting the edges of a pin
+bool AvantDigitalRead::removePulseCounter(int pin) {
+  if (deferChanges()) {
+    PinHandle handle = pinHandle(pin);
+    if (!handle) {
+      return false;
+    }
+    PendingPinChange change = pinChange(PIN_CHANGE_COUNTER, handle);
+    change.enabled = false;
+    queueChange(change);
+    return true;
+  }
+  applyPendingChanges();
+  if (findCounter(pin) == nullptr) {
+    return false;
+  }
+  applyCounter(resolvePin(pinHandle(pin)), false, EVENT_CHANGE, 0, nullptr);
+  return true;
+}
+
+// Edges counted since the counter was set or reset (64 bits: does not overflow)
+uint64_t AvantDigitalRead::getPulseCount(int pin) {
+  PulseCounter* counter = findCounter(pin);
+  return counter != nullptr ? counter->total : 0;
+}
+
+// Restart the count of a pin; the next edge starts a new period average
+bool AvantDigitalRead::resetPulseCount(int pin) {
+  PulseCounter* counter = findCounter(pin);
+  if (counter == nullptr) {
+    return false;
+  }
+  counter->total = 0;
+  counter->periodUs = 0;
+  counter->spanPeriods = 0;
+  return true;
+}
+
+// Frequency of the edges in Hz, from the average period of the current window.
+// Falls towards 0 once no edge came for longer than that period.
+float AvantDigitalRead::getPulseFrequency(int pin) {
+  PulseCounter* counter = findCounter(pin);
+  if (counter == nullptr) {
+    return 0;
+  }
+  uint32_t periodUs = counter->spanPeriods != 0 ?
+                      (counter->lastPulseUs - counter->spanStartUs) / counter->spanPeriods : counter->periodUs;
+  if (periodUs == 0) {
+    return 0;
+  }
+  uint32_t sinceUs = readingTimeUs - counter->lastPulseUs;
+  if (sinceUs > periodUs && sinceUs < 0x80000000UL) {
+    periodUs = sinceUs;
+  }
+  return 1000000.0f / periodUs;
+}
+
+// Edges per second in the last complete window
+float AvantDigitalRead::getPulseRate(int pin) {
+  PulseCounter* counter = findCounter(pin);
+  return counter != nullptr ? counter->rate : 0;
+}
+
+// Add a named profile with the default timing (changes not deferred)
+bool AvantDigitalRead::createProfile(const char* name) {
+  if (name == nullptr || name[0] == '\0' || findProfile(name) >= 0) {
+    return false;
+  }
+  int profile = allocateProfile(profiles[0]);
+  if (profile < 0) {
+    return false;
+  }
+  copyProfileName(profiles[profile], name);
+  return true;
+}
+
+// Add a named profile with the default timing
+bool AvantDigitalRead::addProfile(const char* name) {
+  if (deferChanges()) {
+    if (name == nullptr || name[0] == '\0') {
+      return false;
+    }
+    return queueProfileChange(PIN_CHANGE_ADD_PROFILE, PinHandle(), name);
+  }
+  applyPendingChanges();
+  return createProfile(name);
+}
+
+// Remove a named profile; its pins keep their timing
+bool AvantDigitalRead::removeProfile(const char* name) {
+  if (deferChanges()) {
+    if (name == nullptr || name[0] == '\0') {
+      return false;
+    }
+    return queueProfileChange(PIN_CHANGE_REMOVE_PROFILE, PinHandle(), name);
+  }
+  applyPendingChanges();
+  int profile = findProfile(name);
+  if (profile < 0) {
+    return false;
+  }
+  // The profile becomes unnamed: its pins keep using it until their timing changes
+  profiles[profile].name[0] = '\0';
+  return true;
+}
+
+// Make a pin use a named profile (nullptr: back to the default timing)
+bool AvantDigitalRead::setPinProfile(PinHandle handle, const char* name) {
+  if (deferChanges()) {
+    if (!handle) {
+      return false;
+    }
+    return queueProfileChange(PIN_CHANGE_SET_PROFILE, handle, name);
+  }
+  applyPendingChanges();
+  PinInfo* pinInfo = resolvePin(handle);
+  if (pinInfo == nullptr) {
+    return false;
+  }
+  int profile = name == nullptr ? 0 : findProfile(name);
+  if (profile < 0) {
+    return false;
+  }
+  assignProfile(pinInfo, profile);
+  return true;
+}
+
+// Make a pin use a named profile (nullptr: back to the default timing) by pin number
+bool AvantDigitalRead::setPinProfile(int pin, const char* name) {
+  return setPinProfile(pinHandle(pin), name);
+}
+
+// Copy the name of a pin's profile (false and an empty name if the pin has its own timing).
+// Copied because profiles may reallocate and unnamed slots are recycled.
+bool AvantDigitalRead::getPinProfile(PinHandle handle, char* name, size_t size) {
+  if (name == nullptr || size == 0) {
+    return false;
+  }
+  name[0] = '\0';
+  PinInfo* pinInfo = resolvePin(handle);
+  if (pinInfo == nullptr || profiles[pinInfo->profile].name[0] == '\0') {
+    return false;
+  }
+  strncpy(name, profiles[pinInfo->profile].name, size - 1);
+  name[size - 1] = '\0';
+  return true;
+}
+
+// Copy the name of a pin's profile by pin number
+bool AvantDigitalRead::getPinProfile(int pin, char* name, size_t size) {
+  return getPinProfile(pinHandle(pin), name, size);
+}
+
+// Set the debounce time of every pin using a profile
+bool AvantDigitalRead::setProfileDebounceTime(const char* name, unsigned long debounceMs) {
+  if (!validTiming(debounceMs)) {
+    return false;
+  }
+  GestureProfile values = {};
+  values.debounceTime = (uint16_t)debounceMs;
+  return changeProfileTiming(name, values, TIMING_DEBOUNCE);
+}
+
+// Set the click parameters of every pin using a profile
+bool AvantDigitalRead::setProfileClickParameters(const char* name, unsigned long minPressMs, unsigned long maxPressMs) {
+  if (!validTiming(minPressMs) || !validTiming(maxPressMs)) {
+    return false;
+  }
+  GestureProfile values = {};
+  values.minPressMs = (uint16_t)minPressMs;
+  values.maxPressMs = (uint16_t)maxPressMs;
+  return changeProfileTiming(name, values, TIMING_CLICK);
+}
+
+// Set the double press interval of every pin using a profile
+bool AvantDigitalRead::setProfileDoublePressInterval(const char* name, unsigned long maxIntervalMs) {
+  if (!validTiming(maxIntervalMs)) {
+    return false;
+  }
+  GestureProfile values = {};
+  values.maxIntervalMs = (uint16_t)maxIntervalMs;
+  return changeProfileTiming(name, values, TIMING_INTERVAL);
+}
+
+// Set the long press parameters of every pin using a profile
+bool AvantDigitalRead::setProfileLongPress(const char* name, unsigned long pressDurationMs, bool repeat) {
+  if (!validTiming(pressDurationMs)) {
+    return false;
+  }
+  GestureProfile values = {};
+  values.pressDurationMs = (uint16_t)pressDurationMs;
+  values.repeatLongPress = repeat;
+  return changeProfileTiming(name, values, TIMING_LONG_PRESS);
+}
+
+// Enable pin events
+bool AvantDigitalRead::enablePinEvents(PinHandle handle) {
+  if (deferChanges()) {
+    if (!handle) {
+      return false;
+    }
+    PendingPinChange change = pinChange(PIN_CHANGE_EVENTS, handle);
+    change.enabled = true;
+    queueChange(change);
+    return true;
+  }
+  applyPendingChanges();
+  if (resolvePin(handle) == nullptr) {
+    return false;
+  }
+  setEventsEnabled(handle, true);
+  return true;
+}
+
+// Enable pin events by pin number
+bool AvantDigitalRead::enablePinEvents(int pin) {
+  return enablePinEvents(pinHandle(pin));
+}
+
+// Disable pin events
+bool AvantDigitalRead::disablePinEvents(PinHandle handle) {
+  if (deferChanges()) {
+    if (!handle) {
+      return false;
+    }
+    PendingPinChange change = pinChange(PIN_CHANGE_EVENTS, handle);
+    change.enabled = false;
+    queueChange(change);
+    return true;
+  }
+  applyPendingChanges();
+  if (resolvePin(handle) == nullptr) {
+    return false;
+  }
+  setEventsEnabled(handle, false);
+  return true;
+}
+
+// Disable pin events by pin number
+bool AvantDigitalRead::disablePinEvents(int pin) {
+  return disablePinEvents(pinHandle(pin));
+}
+
+// Enable all events
+void AvantDigitalRead::enableAllEvents() {
+  if (deferChanges()) {
+    PendingPinChange change = pinChange(PIN_CHANGE_EVENTS, PinHandle());
+    change.enabled = true;
+    queueChange(change);
+    return;
+  }
+  applyPendingChanges();
+  setEventsEnabled(PinHandle(), true);
+}
+
+// Disable all events
+void AvantDigitalRead::disableAllEvents() {
+  if (deferChanges()) {
+    PendingPinChange change = pinChange(PIN_CHANGE_EVENTS, PinHandle());
+    change.enabled = false;
+    queueChange(change);
+    return;
+  }
+  applyPendingChanges();
+  setEventsEnabled(PinHandle(), false);
+}
+
+// Read, debounce and detect gestures on all pins
+void AvantDigitalRead::samplePins(unsigned long currentTime) {
+  // Changes made since the last pass; callbacks run below only queue theirs
+  applyPendingChanges(false);
+  inPass = true;
+  
+  // Pins read by the sampling timer are processed from their buffered samples
+  if (timerSampling.load(std::memory_order_acquire)) {
+    processTimerSamples();
+  }
+  
+  advanceEpoch(currentTime);
+  readingTimeUs = micros();
+  for (auto& pinInfo : pinList) {
+    if (!pinInfo.inUse || pinInfo.timerSampled) {
+      continue;
+    }
+    
+    // Read current pin state
+    processReading(pinInfo, digitalRead(pinInfo.pin), currentTime);
+    
+    // Detect button gestures
+    detectButtonGestures(&pinInfo, currentTime);
+  }
+  decodeEncoders(currentTime, false);
+  updateCounters(currentTime, false);
+  inPass = false;
+  publishLevels();
+}
+
+// Debounce one raw reading of a pin and emit edge events
+void AvantDigitalRead::processReading(PinInfo& pinInfo, int rawReading, unsigned long currentTime) {
+  uint16_t now = (uint16_t)(currentTime - timeEpoch);
+  
+  // Release events held back by the pin's throttle
+  if (pinInfo.throttle != 0) {
+    flushThrottle(pinInfo, currentTime);
+  }
+  
+  // Debounce processing
+  uint16_t debounceTime = profiles[pinInfo.profile].debounceTime;
+  if (rawReading != pinInfo.lastState) {
+    AVANT_TRACE(TRACE_LEVEL_PINS, TRACE_RAW_EDGE, pinInfo.pin, rawReading ? EVENT_RISING : EVENT_FALLING,
+                readingTimeUs, 0);
+    
+    // The first edge after a stable period is the time the transition really started
+    if ((uint16_t)(now - pinInfo.lastDebounceTime) > debounceTime) {
+      pinInfo.edgeTimeUs = readingTimeUs;
+    }
+    pinInfo.lastDebounceTime = now;
+  }
+  
+  if ((uint16_t)(now - pinInfo.lastDebounceTime) > debounceTime) {
+    // If state is stable, update state
+    if (rawReading != pinInfo.currentState) {
+      // Save previous state
+      PinState previousState = (PinState)pinInfo.currentState;
+      PinState newState = (PinState)rawReading;
+      
+      // Update current state
+      pinInfo.currentState = newState;
+      setLevel(&pinInfo, newState == PIN_HIGH);
+      AVANT_TRACE(TRACE_LEVEL_PINS, TRACE_DEBOUNCED, pinInfo.pin, newState == PIN_HIGH ? EVENT_RISING : EVENT_FALLING,
+                  readingTimeUs, readingTimeUs - pinInfo.edgeTimeUs);
+      if (!counters.empty()) {
+        countPulse(pinInfo, newState);
+      }
+      
+      // Check button press and release
+      if (newState == PIN_LOW && previousState == PIN_HIGH) {
+        // Button pressed (in INPUT_PULLUP mode, press is LOW)
+        pinInfo.pressStartTime = now;
+        pinInfo.pressActive = true;
+        if (pinInfo.clickCount < 255) {
+          setClickCount(&pinInfo, pinInfo.clickCount + 1); // Increase click count
+        }
+      }
+      
+      // Trigger event callbacks: change plus the rising or falling edge
+      if (pinInfo.eventsEnabled &&
+          (pinInfo.throttle == 0 || admitEdge(pinInfo, previousState, currentTime))) {
+        uint8_t edgeEvents = eventBit(EVENT_CHANGE) |
+                             eventBit(newState == PIN_HIGH ? EVENT_RISING : EVENT_FALLING);
+        emitPinEvents(&pinInfo, edgeEvents, newState, previousState, currentTime);
+      }
+    }
+  }
+  
+  // Update lastState to current raw reading (for next comparison)
+  pinInfo.lastState = rawReading ? 1 : 0;
+}
+
+// Feed the samples accumulated by the sampling timer through processReading()
+void AvantDigitalRead::processTimerSamples() {
+  // Resolve the timer pins once per pass instead of once per sample
+  PinInfo* pins[MAX_TIMER_SAMPLED_PINS];
+  size_t pinCount = timerPins.size();
+  for (size_t i = 0; i < pinCount; i++) {
+    pins[i] = resolvePin(timerPins[i].handle);
+  }
+  
+  RawSample rawSample;
+  unsigned long sampleTime = 0;
+  bool sampled = false;
+  while (sampleBuffer.pop(rawSample)) {
+    // Deterministic time base: derived from the sample number, not from when update() runs
+    timerElapsedUs += (uint64_t)(uint32_t)(rawSample.sequence - expectedSequence) * sampleIntervalUs;
+    expectedSequence = rawSample.sequence + 1;
+    sampleTime = timerStartTime + (unsigned long)(timerElapsedUs / 1000);
+    sampled = true;
+    readingTimeUs = timerStartUs + (uint32_t)timerElapsedUs;
+    timerElapsedUs += sampleIntervalUs;
+    advanceEpoch(sampleTime);
+    for (size_t i = 0; i < pinCount; i++) {
+      if (pins[i] == nullptr) {
+        continue;
+      }
+      processReading(*pins[i], (int)((rawSample.levels >> i) & 1), sampleTime);
+      detectButtonGestures(pins[i], sampleTime);
+    }
+    decodeEncoders(sampleTime, true);
+  }
+  if (sampled) {
+    updateCounters(sampleTime, true);
+  }
+}
+
+// Core update function
+void AvantDigitalRead::update() {
+  unsigned long currentTime = millis();
+  
+  // Run callbacks directly while sampling
+  queueEvents = false;
+  samplePins(currentTime);
+  
+  // Process delayed callbacks
+  processDelayedCallbacks(currentTime);
+}
+
+// Sampling stage
+void AvantDigitalRead::sample() {
+  // Queue events for the dispatch stage instead of running callbacks here
+  queueEvents = true;
+  samplePins(millis());
+}
+
+// Dispatch stage
+void AvantDigitalRead::dispatch() {
+  QueuedEvent queued;
+  while (eventQueue.pop(queued)) {
+    // A marker without callback drops the delayed calls of a removed or disabled pin
+    // (EVENT_TIMER: removed, its timers too)
+    if (queued.callback == nullptr) {
+      cancelPending(queued.pin, queued.event == EVENT_TIMER);
+      continue;
+    }
+    triggerCallback(queued.callback, queued.pin, queued.newState, queued.oldState,
+                    queued.event, queued.timestamp, queued.delayMs, queued.replacePending, queued.timing);
+  }
+  
+  // Process delayed callbacks
+  processDelayedCallbacks(millis());
+}
+
+#if defined(ESP32)
+// Sampling task: run the sampling stage at a fixed rate
+void AvantDigitalRead::samplingTaskEntry(void* arg) {
+  AvantDigitalRead* self = static_cast<AvantDigitalRead*>(arg);
+  TickType_t period = pdMS_TO_TICKS(self->samplePeriodMs);
+  if (period == 0) {
+    period = 1;
+  }
+  TickType_t lastWake = xTaskGetTickCount();
+  while (self->pipelineRunning.load(std::memory_order_acquire)) {
+    self->sample();
+    // The dispatch task outlives the sampler (stopPipeline() stops it second), so its handle is set
+    if (!self->eventQueue.empty()) {
+      xTaskNotifyGive(self->dispatchTask.load(std::memory_order_acquire));
+    }
+    vTaskDelayUntil(&lastWake, period);
+  }
+  self->samplingTask.store(nullptr, std::memory_order_release);
+  vTaskDelete(nullptr);
+}
+
+// Dispatch task: run callbacks when woken by the sampler, and at least every tick for delayed callbacks
+void AvantDigitalRead::dispatchTaskEntry(void* arg) {
+  AvantDigitalRead* self = static_cast<AvantDigitalRead*>(arg);
+  while (self->dispatchRunning.load(std::memory_order_acquire)) {
+    ulTaskNotifyTake(pdTRUE, 1);
+    self->dispatch();
+  }
+  // The sampler has stopped: run the events it queued last
+  self->dispatch();
+  self->dispatchTask.store(nullptr, std::memory_order_release);
+  vTaskDelete(nullptr);
+}
+#endif
+
+// Start the sampling and dispatch stages in their own tasks
+bool AvantDigitalRead::startPipeline(unsigned long samplePeriodMs, int samplingCore, int dispatchCore) {
+  if (pipelineRunning.load(std::memory_order_acquire)) {
+    return false;
+  }
+  this->samplePeriodMs = samplePeriodMs;
+  
+  // Room for pins added from callbacks while the tasks walk the pin table
+  applyPendingChanges();
+  reservePinHeadroom();
+  pipelineRunning.store(true, std::memory_order_release);
+  dispatchRunning.store(true, std::memory_order_release);
+  
+#if defined(ESP32)
+  // Create the dispatch task first so the sampler can notify it from its first pass. Each
+  // handle is stored before the task can exit: only stopPipeline(), called later from this
+  // task, makes them exit.
+  TaskHandle_t task = nullptr;
+  if (xTaskCreatePinnedToCore(dispatchTaskEntry, "AvantDispatch", PIPELINE_TASK_STACK_SIZE,
+                              this, 1, &task, dispatchCore) != pdPASS) {
+    dispatchRunning.store(false, std::memory_order_release);
+    pipelineRunning.store(false, std::memory_order_release);
+    return false;
+  }
+  dispatchTask.store(task, std::memory_order_release);
+  task = nullptr;
+  if (xTaskCreatePinnedToCore(samplingTaskEntry, "AvantSample", PIPELINE_TASK_STACK_SIZE,
+                              this, configMAX_PRIORITIES - 2, &task, samplingCore) != pdPASS) {
+    stopPipeline();
+    return false;
+  }
+  samplingTask.store(task, std::memory_order_release);
+  return true;
+#elif !defined(ARDUINO)
+  // Host build: two threads, cores are not pinned, a period of 0 runs the sampler flat out
+  (void)samplingCore;
+  (void)dispatchCore;
+  dispatchThread = std::thread([this]() {
+    while (dispatchRunning.load(std::memory_order_acquire)) {
+      dispatch();
+      if (eventQueue.empty()) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }
+    dispatch();
+  });
+  samplingThread = std::thread([this]() {
+    std::chrono::steady_clock::time_point nextWake = std::chrono::steady_clock::now();
+    while (pipelineRunning.load(std::memory_order_acquire)) {
+      sample();
+      if (this->samplePeriodMs == 0) {
+        std::this_thread::yield();
+      } else {
+        nextWake += std::chrono::milliseconds(this->samplePeriodMs);
+        std::this_thread::sleep_until(nextWake);
+      }
+    }
+  });
+  return true;
+#else
+  (void)samplingCore;
+  (void)dispatchCore;
+  dispatchRunning.store(false, std::memory_order_release);
+  pipelineRunning.store(false, std::memory_order_release);
+  return false;
+#endif
+}
+
+// Stop the pipeline tasks and wait for them to finish
+void AvantDigitalRead::stopPipeline() {
+  // The sampler first: the dispatcher keeps running until it has taken the sampler's last events
+  pipelineRunning.store(false, std::memory_order_release);
+#if defined(ESP32)
+  while (samplingTask.load(std::memory_order_acquire) != nullptr) {
+    vTaskDelay(1);
+  }
+  dispatchRunning.store(false, std::memory_order_release);
+  while (dispatchTask.load(std::memory_order_acquire) != nullptr) {
+    vTaskDelay(1);
+  }
+#elif !defined(ARDUINO)
+  if (samplingThread.joinable()) {
+    samplingThread.join();
+  }
+  dispatchRunning.store(false, std::memory_order_release);
+  if (dispatchThread.joinable()) {
+    dispatchThread.join();
+  }
+#endif
+}
+
+// Check if the pipeline tasks are running
+bool AvantDigitalRead::isPipelineRunning() {
+  return pipelineRunning.load(std::memory_order_acquire);
+}
+
+// Get the number of events dropped because the event queue was full
+unsigned long AvantDigitalRead::getDroppedEvents() {
+  return droppedEvents.load(std::memory_order_relaxed);
+}
+
+// Get the number of events waiting for the dispatch stage
+size_t AvantDigitalRead::getQueuedEvents() {
+  return eventQueue.size();
+}
+
+#if defined(ESP32)
+// Sampling timer callback
+void AvantDigitalRead::sampleTimerEntry(void* arg) {
+  static_cast<AvantDigitalRead*>(arg)->captureSample();
+}
+#endif
+
+// Start sampling all current pins from a periodic timer
+bool AvantDigitalRead::beginTimerSampling(unsigned long sampleRateHz, bool internalTimer) {
+  if (timerSampling.load(std::memory_order_acquire) || sampleRateHz == 0 || sampleRateHz > 1000000) {
+    return false;
+  }
+  int pinCount = 0;
+  for (auto& pinInfo : pinList) {
+    pinCount += pinInfo.inUse;
+  }
+  if (pinCount == 0 || pinCount > MAX_TIMER_SAMPLED_PINS) {
+    return false;
+  }
+  
+  // Fix the set of sampled pins; pins added later are read by update() as usual
+  timerPins.clear();
+  for (auto& pinInfo : pinList) {
+    if (pinInfo.inUse) {
+      TimerPin timerPin = {pinInfo.pin, handleOf(&pinInfo)};
+      timerPins.push_back(timerPin);
+      pinInfo.timerSampled = true;
+    }
+  }
+  
+  // Counters of these pins change clocks: their windows restart in the sample clock
+  for (auto& counter : counters) {
+    counter.windowStarted = false;
+  }
+  
+  RawSample stale;
+  while (sampleBuffer.pop(stale)) {
+  }
+  captureSequence = 0;
+  expectedSequence = 0;
+  timerElapsedUs = 0;
+  sampleIntervalUs = 1000000UL / sampleRateHz;
+  // Both clocks are taken together: sample times in ms for the gesture timing, in us for EventTiming
+  timerStartTime = millis();
+  timerStartUs = micros();
+  overrunSamples.store(0, std::memory_order_relaxed);
+  timerSampling.store(true, std::memory_order_release);
+  
+  if (!internalTimer) {
+    // The caller drives captureSample() at sampleRateHz
+    return true;
+  }
+  
+#if defined(ESP32)
+  esp_timer_create_args_t timerArgs = {};
+  timerArgs.callback = sampleTimerEntry;
+  timerArgs.arg = this;
+  timerArgs.dispatch_method = ESP_TIMER_TASK;
+  timerArgs.name = "AvantSample";
+  if (esp_timer_create(&timerArgs, &sampleTimer) != ESP_OK) {
+    sampleTimer = nullptr;
+    endTimerSampling();
+    return false;
+  }
+  if (esp_timer_start_periodic(sampleTimer, sampleIntervalUs) != ESP_OK) {
+    endTimerSampling();
+    return false;
+  }
+  return true;
+#elif !defined(ARDUINO)
+  // Host stand-in for the hardware timer
+  sampleTimerThread = std::thread([this]() {
+    std::chrono::steady_clock::time_point nextWake = std::chrono::steady_clock::now();
+    while (timerSampling.load(std::memory_order_acquire)) {
+      captureSample();
+      nextWake += std::chrono::microseconds(sampleIntervalUs);
+      std::this_thread::sleep_until(nextWake);
+    }
+  });
+  return true;
+#else
+  endTimerSampling();
+  return false;
+#endif
+}
+
+// Stop timer sampling and go back to reading pins in update()
+void AvantDigitalRead::endTimerSampling() {
+  timerSampling.store(false, std::memory_order_release);
+#if defined(ESP32)
+  if (sampleTimer != nullptr) {
+    esp_timer_stop(sampleTimer);
+    esp_timer_delete(sampleTimer);
+    sampleTimer = nullptr;
+  }
+#elif !defined(ARDUINO)
+  if (sampleTimerThread.joinable()) {
+    sampleTimerThread.join();
+  }
+#endif
+  for (auto& pinInfo : pinList) {
+    pinInfo.timerSampled = false;
+  }
+  for (auto& counter : counters) {
+    counter.windowStarted = false;
+  }
+  timerPins.clear();
+}
+
+// Check if timer sampling is active
+bool AvantDigitalRead::isTimerSampling() {
+  return timerSampling.load(std::memory_order_acquire);
+}
+
+// Take one sample of all timer-sampled pins
+void AvantDigitalRead::captureSample() {
+  if (!timerSampling.load(std::memory_order_acquire)) {
+    return;
+  }
+  RawSample rawSample;
+  rawSample.levels = 0;
+  rawSample.sequence = captureSequence++;
+  for (size_t i = 0; i < timerPins.size(); i++) {
+    if (digitalRead(timerPins[i].pin) == HIGH) {
+      rawSample.levels |= (uint64_t)1 << i;
+    }
+  }
+  if (!sampleBuffer.push(rawSample)) {
+    // update() is not keeping up; the gap still advances the time base
+    overrunSamples.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// Get the number of samples lost because update() was not called often enough
+unsigned long AvantDigitalRead::getOverrunSamples() {
+  return overrunSamples.load(std::memory_order_relaxed);
+}
+
+// Find the first word in [start, end) that differs from word
+static size_t findSampleChange(const uint32_t* words, size_t start, size_t end, uint32_t word) {
+  size_t i = start;
+  // Compare in fixed blocks so the compiler can vectorize the scan
+  while (i + 8 <= end) {
+    uint32_t diff = 0;
+    for (size_t k = 0; k < 8; k++) {
+      diff |= words[i + k] ^ word;
+    }
+    if (diff != 0) {
+      break;
+    }
+    i += 8;
+  }
+  while (i < end && words[i] == word) {
+    i++;
+  }
+  return i;
+}
+
+// Run a buffer of packed port snapshots through debounce and gesture detection
+bool AvantDigitalRead::processSamples(const uint32_t* words, size_t count, uint32_t sampleIntervalUs) {
+  if (words == nullptr || sampleIntervalUs == 0) {
+    return false;
+  }
+  if (!sampleClockStarted) {
+    setSampleClock(millis());
+  }
+  
+  // The pin pointers below are kept for the whole buffer
+  applyPendingChanges(false);
+  inPass = true;
+  
+  // Pins 0-31 map to bits 0-31; timer-sampled pins keep their own source
+  PinInfo* pins[32];
+  uint8_t bits[32];
+  size_t pinCount = 0;
+  for (auto& pinInfo : pinList) {
+    if (pinInfo.inUse && pinInfo.pin < 32 && !pinInfo.timerSampled && pinCount < 32) {
+      pins[pinCount] = &pinInfo;
+      bits[pinCount] = (uint8_t)pinInfo.pin;
+      pinCount++;
+    }
+  }
+  
+  queueEvents = false;
+  uint64_t baseUs = sampleClockUs;
+  size_t i = 0;
+  while (i < count) {
+    uint64_t timeUs = baseUs + (uint64_t)i * sampleIntervalUs;
+    unsigned long currentTime = (unsigned long)(timeUs / 1000);
+    uint32_t word = words[i];
+    
+    // A sample can only change something if the levels or the millisecond changed
+    if (word != lastSampleWord || currentTime != lastSampleTime) {
+      advanceEpoch(currentTime);
+      readingTimeUs = (uint32_t)timeUs;
+      for (size_t p = 0; p < pinCount; p++) {
+        processReading(*pins[p], (int)((word >> bits[p]) & 1), currentTime);
+        detectButtonGestures(pins[p], currentTime);
+      }
+      decodeEncoders(currentTime, false);
+      if (currentTime != lastSampleTime) {
+        updateCounters(currentTime, false);
+        if (pendingDelayed != 0) {
+          processDelayedCallbacks(currentTime);
+        }
+      }
+      lastSampleWord = word;
+      lastSampleTime = currentTime;
+    }
+    
+    // Skip the unchanged samples that remain in this millisecond
+    uint64_t nextMsUs = (timeUs / 1000 + 1) * 1000;
+    size_t end = i + 1 + (size_t)((nextMsUs - timeUs - 1) / sampleIntervalUs);
+    if (end > count) {
+      end = count;
+    }
+    i = findSampleChange(words, i + 1, end, word);
+  }
+  sampleClockUs = baseUs + (uint64_t)count * sampleIntervalUs;
+  inPass = false;
+  publishLevels();
+  return true;
+}
+
+// Run one port snapshot taken at an explicit time (for irregular captures such as VCD files)
+void AvantDigitalRead::processSample(uint32_t word, unsigned long timeMs) {
+  applyPendingChanges(false);
+  inPass = true;
+  queueEvents = false;
+  advanceEpoch(timeMs);
+  readingTimeUs = (uint32_t)timeMs * 1000u;
+  for (auto& pinInfo : pinList) {
+    if (pinInfo.inUse && pinInfo.pin < 32 && !pinInfo.timerSampled) {
+      processReading(pinInfo, (int)((word >> pinInfo.pin) & 1), timeMs);
+      detectButtonGestures(&pinInfo, timeMs);
+    }
+  }
+  decodeEncoders(timeMs, false);
+  updateCounters(timeMs, false);
+  inPass = false;
+  publishLevels();
+  if (timeMs != lastSampleTime && pendingDelayed != 0) {
+    processDelayedCallbacks(timeMs);
+  }
+  lastSampleWord = word;
+  lastSampleTime = timeMs;
+}
+
+// Set the time of the next sample passed to processSamples()
+void AvantDigitalRead::setSampleClock(unsigned long timeMs) {
+  sampleClockUs = (uint64_t)timeMs * 1000;
+  sampleClockStarted = true;
+  lastSampleTime = timeMs - 1;
+}
+
+// Start recording callback latency histograms of a pin
+bool AvantDigitalRead::enableLatencyStats(int pin) {
+#if AVANT_LATENCY_STATS
+  if (pin < 0 || pin > 255) {
+    return false;
+  }
+  if (latencyTable->index[pin] == 0) {
+    size_t recorded = latencyTable->stats.size() / LATENCY_EVENT_TYPES;
+    if (recorded >= 255) {
+      return false;
+    }
+    LatencyHistogram empty;
+    memset(&empty, 0, sizeof(empty));
+    latencyTable->stats.resize(latencyTable->stats.size() + LATENCY_EVENT_TYPES, empty);
+    latencyTable->index[pin] = (uint8_t)(recorded + 1);
+  }
+  return true;
+#else
+  (void)pin;
+  return false;
+#endif
+}
+
+// Copy the callback latency histogram of a pin's event type
+bool AvantDigitalRead::getLatencyStats(int pin, EventType event, LatencyHistogram* histogram) {
+#if AVANT_LATENCY_STATS
+  if (pin < 0 || pin > 255 || latencyTable->index[pin] == 0 || histogram == nullptr ||
+      event < 0 || event >= LATENCY_EVENT_TYPES) {
+    return false;
+  }
+  *histogram = latencyTable->stats[(latencyTable->index[pin] - 1) * LATENCY_EVENT_TYPES + event];
+  return true;
+#else
+  (void)pin;
+  (void)event;
+  (void)histogram;
+  return false;
+#endif
+}
+
+// Clear all recorded histograms (pins stay enabled)
+void AvantDigitalRead::resetLatencyStats() {
+#if AVANT_LATENCY_STATS
+  if (!latencyTable->stats.empty()) {
+    memset(latencyTable->stats.data(), 0, latencyTable->stats.size() * sizeof(LatencyHistogram));
+  }
+#endif
+}
+
+// Set the longest acceptable callback run and what to do when a callback exceeds it
+void AvantDigitalRead::setCallbackBudget(unsigned long budgetUs, SlowCallbackHook hook, bool deferSlow) {
+  callbackBudgetUs = budgetUs;
+  slowCallbackHook = hook;
+  deferSlowCallbacks = budgetUs != 0 && deferSlow;
+}
+
+// Get the callback budget (0 = off)
+unsigned long AvantDigitalRead::getCallbackBudget() {
+  return callbackBudgetUs;
+}
+
+// Get the number of callback functions timed so far
+size_t AvantDigitalRead::getCallbackStatsCount() {
+  return callbackStats.size();
+}
+
+// Copy the run time statistics of the index-th timed callback function
+bool AvantDigitalRead::getCallbackStats(size_t index, CallbackStats* stats) {
+  if (index >= callbackStats.size() || stats == nullptr) {
+    return false;
+  }
+  *stats = callbackStats[index];
+  return true;
+}
+
+// Forget all callback statistics, which also restores demoted callbacks
+void AvantDigitalRead::resetCallbackStats() {
+  callbackStats.clear();
+}
+
+#if AVANT_TRACE_LEVEL > 0
+// Append a trace record; the oldest record is overwritten when the buffer is full
+void AvantDigitalRead::trace(TraceId id, int pin, EventType event, uint32_t eventTimeUs, uint32_t value) {
+  // Sampling and dispatch tasks may both write: each claims its own record
+  uint32_t index = traceBuffer->head.fetch_add(1, std::memory_order_relaxed);
+  size_t slot = index & (AVANT_TRACE_BUFFER_SIZE - 1);
+  std::atomic<uint32_t>& sequence = traceBuffer->sequence[slot];
+  
+  // Take the slot unless a writer a full lap behind still fills it (the record is then
+  // dropped; the reader counts it as lost)
+  uint32_t previous = sequence.load(std::memory_order_relaxed);
+  if ((previous & 1) || (int32_t)(previous - (index * 2 + 2)) >= 0 ||
+      !sequence.compare_exchange_strong(previous, index * 2 + 1, std::memory_order_relaxed)) {
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+  
+  TraceRecord record;
+  record.timeUs = micros();
+  record.eventTimeUs = eventTimeUs;
+  record.value = value;
+  record.id = (uint8_t)id;
+  record.pin = (unsigned)pin < 255 ? (uint8_t)pin : 255;
+  record.event = (uint8_t)event;
+  record.reserved = 0;
+  uint32_t words[TRACE_RECORD_WORDS];
+  memcpy(words, &record, sizeof(record));
+  for (int i = 0; i < TRACE_RECORD_WORDS; i++) {
+    traceBuffer->words[slot][i].store(words[i], std::memory_order_relaxed);
+  }
+  
+  // Commit
+  sequence.store(index * 2 + 2, std::memory_order_release);
+}
+#endif
+
+// Copy and remove the oldest trace records, returns how many were copied
+size_t AvantDigitalRead::readTrace(TraceRecord* records, size_t maxRecords) {
+#if AVANT_TRACE_LEVEL > 0
+  if (records == nullptr) {
+    return 0;
+  }
+  uint32_t head = traceBuffer->head.load(std::memory_order_acquire);
+  if (head - traceBuffer->tail > AVANT_TRACE_BUFFER_SIZE) {
+    // Records older than the buffer were overwritten
+    traceBuffer->lost += head - AVANT_TRACE_BUFFER_SIZE - traceBuffer->tail;
+    traceBuffer->tail = head - AVANT_TRACE_BUFFER_SIZE;
+  }
+  size_t count = 0;
+  while (traceBuffer->tail != head && count < maxRecords) {
+    size_t slot = traceBuffer->tail & (AVANT_TRACE_BUFFER_SIZE - 1);
+    uint32_t committed = traceBuffer->tail * 2 + 2;
+    uint32_t before = traceBuffer->sequence[slot].load(std::memory_order_acquire);
+    if ((int32_t)(before - committed) < 0) {
+      // Claimed but not written yet: read it next time
+      break;
+    }
+    traceBuffer->tail++;
+    if (before != committed) {
+      // A later record took the slot
+      traceBuffer->lost++;
+      continue;
+    }
+    uint32_t words[TRACE_RECORD_WORDS];
+    for (int i = 0; i < TRACE_RECORD_WORDS; i++) {
+      words[i] = traceBuffer->words[slot][i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (traceBuffer->sequence[slot].load(std::memory_order_relaxed) != before) {
+      // Overwritten while it was copied
+      traceBuffer->lost++;
+      continue;
+    }
+    memcpy(&records[count++], words, sizeof(TraceRecord));
+  }
+  return count;
+#else
+  (void)records;
+  (void)maxRecords;
+  return 0;
+#endif
+}
+
+// Format and remove the recorded trace records, returns how many were printed
+size_t AvantDigitalRead::printTrace(Print& out) {
+  static const char* const traceNames[] = {
+    "event", "dropped", "slow callback", "delayed added", "delayed replaced", "delayed run", "delayed cancelled",
+    "callback", "raw edge", "debounced", "click state"
+  };
+  static const char* const valueNames[] = {
+    "delay ms", "delay ms", "run us", "delay ms", "delay ms", "late ms", nullptr,
+    "run us", nullptr, "window us", "clicks"
+  };
+  static const char* const eventNames[] = {
+    "CHANGE", "RISING", "FALLING", "SINGLE_PRESS", "DOUBLE_PRESS", "LONG_PRESS", "SINGLE_PRESS_RETRACT", "TIMER",
+    "ENCODER", "PULSE_REPORT"
+  };
+  
+  TraceRecord records[8];
+  size_t printed = 0;
+  size_t count;
+  while ((count = readTrace(records, 8)) != 0) {
+    for (size_t i = 0; i < count; i++) {
+      const TraceRecord& record = records[i];
+      if (record.id > TRACE_CLICK_STATE || record.event > EVENT_PULSE_REPORT) {
+        continue;
+      }
+      out.print(record.timeUs);
+      out.print(" us: ");
+      out.print(traceNames[record.id]);
+      out.print(", pin ");
+      out.print(record.pin);
+      out.print(", ");
+      out.print(eventNames[record.event]);
+      out.print(", at ");
+      out.print(record.eventTimeUs);
+      out.print(" us");
+      if (valueNames[record.id] != nullptr) {
+        out.print(", ");
+        out.print(valueNames[record.id]);
+        out.print(" ");
+        out.print(record.value);
+      }
+      out.println();
+      printed++;
+    }
+  }
+  return printed;
+}
+
+// Drop all recorded trace records
+void AvantDigitalRead::clearTrace() {
+#if AVANT_TRACE_LEVEL > 0
+  traceBuffer->tail = traceBuffer->head.load(std::memory_order_acquire);
+#endif
+}
+
+// Get the number of trace records overwritten before they were read
+unsigned long AvantDigitalRead::getLostTraceRecords() {
+#if AVANT_TRACE_LEVEL > 0
+  return traceBuffer->lost;
+#else
+  return 0;
+#endif
+}
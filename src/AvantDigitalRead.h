@@ -3,6 +3,54 @@
 
 #include <Arduino.h>
 #include <vector>
+#include <atomic>
+#include "AvantEventQueue.h"
+
+#if defined(ESP32)
+#include "esp_timer.h"
+#elif !defined(ARDUINO)
+#include <thread>
+#include <mutex>
+#endif
+
+// Build options: set them as build flags (-DAVANT_TRACE_LEVEL=2), never with a #define in a
+// sketch, so the library and the sketch are compiled with the same values
+
+// Capacity of the queue between the sampling and dispatch stages (power of two)
+#ifndef AVANT_EVENT_QUEUE_SIZE
+#define AVANT_EVENT_QUEUE_SIZE 64
+#endif
+
+// Capacity of the raw sample buffer filled by the sampling timer (power of two)
+#ifndef AVANT_SAMPLE_BUFFER_SIZE
+#define AVANT_SAMPLE_BUFFER_SIZE 256
+#endif
+
+// Free pin slots kept so another task can add pins without the pin table moving
+#ifndef AVANT_PIN_HEADROOM
+#define AVANT_PIN_HEADROOM 8
+#endif
+
+// Record latency histograms of the callbacks of pins passed to enableLatencyStats()
+#ifndef AVANT_LATENCY_STATS
+#define AVANT_LATENCY_STATS 0
+#endif
+
+// Trace records kept in RAM: 0 = off, 1 = events and callbacks, 2 = also delayed
+// callback scheduling (DEBUG_DELAYED_CALLBACKS selects 2), 3 = also raw edges,
+// debounce and click state of every pin
+#ifndef AVANT_TRACE_LEVEL
+#if defined(DEBUG_DELAYED_CALLBACKS)
+#define AVANT_TRACE_LEVEL 2
+#else
+#define AVANT_TRACE_LEVEL 0
+#endif
+#endif
+
+// Capacity of the trace ring buffer, in records (power of two)
+#ifndef AVANT_TRACE_BUFFER_SIZE
+#define AVANT_TRACE_BUFFER_SIZE 128
+#endif
 
 // Default values for button parameters
 const unsigned long DEFAULT_MIN_PRESS_MS = 50;      // Default minimum valid press duration
@@ -12,6 +60,22 @@ const unsigned long DEFAULT_PRESS_DURATION_MS = 1000; // Default long press dete
 const bool DEFAULT_REPEAT_LONG_PRESS = false;      // Default whether long press repeats
 const unsigned long DEFAULT_DEBOUNCE_TIME = 50;     // Default debounce time
 
+// Default values for the sampling/dispatch pipeline
+const unsigned long DEFAULT_SAMPLE_PERIOD_MS = 1;   // Default sampling stage period
+const int DEFAULT_SAMPLING_CORE = 1;                // Default core for the sampling task (ESP32)
+const int DEFAULT_DISPATCH_CORE = 0;                // Default core for the dispatch task (ESP32)
+const unsigned long PIPELINE_TASK_STACK_SIZE = 4096; // Stack size of each pipeline task (ESP32)
+
+// Timer sampling limits
+const int MAX_TIMER_SAMPLED_PINS = 64;             // Pins captured per timer sample (one bit each)
+const unsigned long DEFAULT_SAMPLE_RATE_HZ = 1000; // Default timer sampling rate
+
+// Rotary encoder defaults
+const uint8_t DEFAULT_ENCODER_STEPS_PER_DETENT = 4; // Quadrature steps between two detents
+
+// Pulse counter defaults
+const unsigned long DEFAULT_PULSE_WINDOW_MS = 1000; // Window of the pulse rate
+
 // Pin state enumeration
 enum PinState {
   PIN_LOW = 0,
@@ -27,13 +91,34 @@ enum EventType {
   EVENT_FALLING,      // Falling edge (HIGH→LOW)
   EVENT_SINGLE_PRESS, // Single press
   EVENT_DOUBLE_PRESS, // Double press
-  EVENT_LONG_PRESS    // Long press
+  EVENT_LONG_PRESS,   // Long press
+  EVENT_SINGLE_PRESS_RETRACT, // Speculative single press turned out to be the first click of a double press
+  EVENT_TIMER,        // Timer started with startTimer() expired
+  EVENT_ENCODER,      // Rotary encoder moved one detent (newState PIN_HIGH: position increased)
+  EVENT_PULSE_REPORT  // Rate window of a pulse counter ended
+};
+
+// Number of event types with pin handlers (bits used in PinInfo::subscribed)
+const int EVENT_TYPE_COUNT = EVENT_SINGLE_PRESS_RETRACT + 1;
+
+// Rate limiting of the edge events (change, rising, falling) of a pin
+enum ThrottlePolicy {
+  THROTTLE_NONE,      // Every transition is emitted
+  THROTTLE_LIMIT,     // Up to maxEvents per window, further transitions are dropped
+  THROTTLE_COALESCE,  // Up to maxEvents per window, then one event with the latest state at the window end
+  THROTTLE_TRAILING   // One event with the latest state once the pin has been quiet for the window
 };
 
 // Callback function prototype (all callbacks use this format)
 typedef void (*PinCallback)(int pin, PinState newState, PinState oldState,
                            EventType event, unsigned long timestamp);
 
+// When the event reported to a running callback happened (micros() time base)
+struct EventTiming {
+  uint32_t edgeUs;      // First raw edge of the transition that led to the event
+  uint32_t acceptedUs;  // Reading in which debounce or gesture detection accepted it
+};
+
 // Structure to store delayed callback information
 struct DelayedCallback {
   PinCallback callback;
@@ -43,101 +128,753 @@ struct DelayedCallback {
   EventType event;
   unsigned long timestamp;
   unsigned long delayMs;
-  bool executed;
+  unsigned long periodMs; // Interval of a periodic timer (0 = one-shot)
+  EventTiming timing;    // Edge and acceptance time of the event
+  bool executed;         // Whether the call has run or was cancelled (the slot is free)
+  uint16_t generation;   // Incremented when the slot is freed, checked by CallbackHandle
+  uint32_t sequence;     // Order the call was last scheduled in (runs calls due together first in, first out)
 };
 
-// Pin configuration and status structure
+// Identifies a pending delayed callback (0 = none). Generation in the upper 16
+// bits, slot index + 1 in the lower 16, so cancel() needs no search.
+typedef uint32_t CallbackHandle;
+
+// Due time of a delayed call, ordered in AvantDigitalRead's timer heap
+struct DueCallback {
+  unsigned long due;     // timestamp + delayMs of the call when it was pushed
+  uint32_t sequence;     // DelayedCallback::sequence, breaks ties between equal due times
+  CallbackHandle handle;
+};
+
+// Structure to pass an event from the sampling stage to the dispatch stage
+struct QueuedEvent {
+  PinCallback callback;
+  int pin;
+  PinState newState;
+  PinState oldState;
+  EventType event;
+  unsigned long timestamp;
+  unsigned long delayMs;
+  bool replacePending;
+  EventTiming timing;
+};
+
+// Latency histogram buckets: bucket b counts values of [2^(b-1), 2^b) us, bucket 0
+// counts 0 us and the last bucket everything from 2^(LATENCY_BUCKETS-2) us up
+const int LATENCY_BUCKETS = 24;
+const int LATENCY_EVENT_TYPES = EVENT_PULSE_REPORT + 1;  // Histograms per pin, indexed by EventType
+
+// Callback timing of one event type of a pin (AVANT_LATENCY_STATS)
+struct LatencyHistogram {
+  uint32_t latency[LATENCY_BUCKETS];   // Callback start minus first raw edge (EventTiming::edgeUs)
+  uint32_t duration[LATENCY_BUCKETS];  // Time the callback ran
+  uint32_t count;                      // Callbacks recorded
+  uint32_t maxLatencyUs;
+  uint32_t maxDurationUs;
+};
+
+// Called after a callback ran longer than the budget set with setCallbackBudget()
+typedef void (*SlowCallbackHook)(PinCallback callback, int pin, EventType event,
+                                 unsigned long durationUs);
+
+// Run time of one callback function, kept while a callback budget is set
+struct CallbackStats {
+  PinCallback callback;
+  uint32_t calls;        // Runs timed
+  uint32_t worstUs;      // Longest run
+  int worstPin;          // Pin and event of the longest run
+  EventType worstEvent;
+  uint32_t overruns;     // Runs longer than the budget
+  bool deferred;         // Demoted: runs after the pass instead of in the middle of it
+};
+
+// Trace levels (AVANT_TRACE_LEVEL)
+const int TRACE_LEVEL_EVENTS = 1;     // Events, dropped events and callback runs
+const int TRACE_LEVEL_CALLBACKS = 2;  // Delayed callbacks scheduled, replaced, run and cancelled
+const int TRACE_LEVEL_PINS = 3;       // Raw edges, debounce windows and click state
+
+// What a trace record reports
+enum TraceId {
+  TRACE_EVENT,              // Event emitted (value: callback delay in ms)
+  TRACE_EVENT_DROPPED,      // Event lost because the event queue was full
+  TRACE_SLOW_CALLBACK,      // Callback ran over the budget (value: run time in us)
+  TRACE_DELAYED_ADDED,      // Delayed call scheduled (value: delay in ms)
+  TRACE_DELAYED_REPLACED,   // Pending delayed call replaced (value: delay in ms)
+  TRACE_DELAYED_RUN,        // Delayed call run (value: ms it ran late)
+  TRACE_DELAYED_CANCELLED,  // Pending delayed call cancelled
+  TRACE_CALLBACK,           // Callback ran (eventTimeUs: start, value: run time in us)
+  TRACE_RAW_EDGE,           // Raw reading changed (event: EVENT_RISING or EVENT_FALLING)
+  TRACE_DEBOUNCED,          // Debounced level changed (event: direction, value: debounce window in us)
+  TRACE_CLICK_STATE         // Clicks of the pending gesture changed (value: click count)
+};
+
+// Storage of the trace ring buffer and the latency histograms (defined by the library build)
+struct AvantTraceBuffer;
+struct AvantLatencyTable;
+
+// One fixed-size trace record, formatted only when printTrace() is called
+struct TraceRecord {
+  uint32_t timeUs;       // micros() when the record was written
+  uint32_t eventTimeUs;  // First edge of an event, due time of a delayed call, start of a
+                         // callback, or reading time of the pin records
+  uint32_t value;        // Meaning depends on id
+  uint8_t id;            // TraceId
+  uint8_t pin;           // Pin number (255 for none)
+  uint8_t event;         // EventType
+  uint8_t reserved;
+};
+
+// Structure to store one raw timer sample of all timer-sampled pins
+struct RawSample {
+  uint64_t levels;    // Bit i holds the level of the i-th timer-sampled pin
+  uint32_t sequence;  // Sample number since beginTimerSampling()
+};
+
+// Words of the pin level snapshot filled by readAll() (bit n of word n / 64 is pin n)
+const int PIN_SNAPSHOT_WORDS = 4;
+
+// Pin table slots published for other tasks (slots are reused lowest first: one per pin number)
+const int MAX_PIN_SLOTS = PIN_SNAPSHOT_WORDS * 64;
+
+// Largest timing value (debounce and gesture parameters) a pin can hold, in ms
+const unsigned long MAX_PIN_TIMING_MS = 32767;
+
+// Gesture profile limits
+const int MAX_GESTURE_PROFILES = 255;              // Profiles per instance (indexed by one byte)
+const int MAX_PROFILE_NAME_LENGTH = 15;            // Characters kept of a profile name
+
+// Pin timestamps are kept relative to an epoch that is moved forward once they
+// get older than TIME_REBASE_THRESHOLD_MS; older stamps saturate at the epoch
+const unsigned long TIME_REBASE_THRESHOLD_MS = 0xF000;
+const unsigned long TIME_REBASE_KEEP_MS = 0x8000;
+
+// Debounce and button timing shared by all pins that use it (ms, up to MAX_PIN_TIMING_MS)
+struct GestureProfile {
+  uint16_t debounceTime;           // Debounce time
+  uint16_t minPressMs;             // Minimum valid press duration
+  uint16_t maxPressMs;             // Maximum valid press duration
+  uint16_t maxIntervalMs;          // Maximum interval for double press
+  uint16_t pressDurationMs;        // Long press detection duration
+  uint16_t pinCount;               // Pins using this profile
+  bool repeatLongPress;            // Whether long press repeats
+  char name[MAX_PROFILE_NAME_LENGTH + 1]; // Empty for the unnamed profiles behind per-pin settings
+};
+
+// Pin configuration and status structure (hot state read on every update(); the
+// handlers are kept apart in PinHandler lists, the timing in GestureProfile)
 struct PinInfo {
-  int pin;                      // Pin number
-  int mode;                     // Pin mode
-  PinState currentState;        // Current state
-  PinState lastState;           // Previous state
-  unsigned long lastDebounceTime; // Last debounce time
-  unsigned long debounceTime;   // Debounce time
-  bool eventsEnabled;           // Whether event detection is enabled
-  
-  // Event callback functions
-  PinCallback onChangeCallback;
-  unsigned long onChangeDelay;
-  PinCallback onRisingCallback;
-  unsigned long onRisingDelay;
-  PinCallback onFallingCallback;
-  unsigned long onFallingDelay;
-  PinCallback onSinglePressCallback;
-  unsigned long onSinglePressDelay;
-  PinCallback onDoublePressCallback;
-  unsigned long onDoublePressDelay;
-  PinCallback onLongPressCallback;
-  unsigned long onLongPressDelay;
-  
-  // Button detection parameters
-  unsigned long minPressMs;     // Minimum valid press duration
-  unsigned long maxPressMs;     // Maximum valid press duration
-  unsigned long maxIntervalMs;  // Maximum interval for double press
-  unsigned long pressDurationMs; // Long press detection duration
-  bool repeatLongPress;         // Whether long press repeats
-  
-  // Button state tracking
-  unsigned long pressStartTime; // Press start time
-  unsigned long releaseTime;    // Release time
-  unsigned long lastClickTime;  // Last click time
-  int clickCount;               // Click count
-  bool longPressTriggered;      // Whether long press has been triggered
+  uint8_t pin;                     // Pin number
+  uint8_t mode;                    // Pin mode
+  uint8_t currentState : 1;        // Current state
+  uint8_t lastState : 1;           // Previous state
+  uint8_t eventsEnabled : 1;       // Whether event detection is enabled
+  uint8_t longPressTriggered : 1;  // Whether long press has been triggered
+  uint8_t pressActive : 1;         // Whether a press is waiting for its release
+  uint8_t timerSampled : 1;        // Whether the pin is read by the sampling timer
+  uint8_t replacePending : 1;      // Whether a delayed event replaces the one still pending for its handler
+  uint8_t speculativeSingle : 1;   // Whether single presses are emitted before the double press window ends
+  uint8_t inUse;                   // Whether the slot holds a pin (other tasks see publishedSlots instead)
+  uint8_t clickCount;              // Click count
+  uint8_t profile;                 // Index of the pin's GestureProfile
+  uint8_t subscribed;              // Bit n set when the pin has a handler for EventType n
+  uint8_t throttle;                // Index + 1 of the pin's PinThrottle (0 = not throttled)
+  
+  // Timestamps (ms since AvantDigitalRead::timeEpoch)
+  uint16_t lastDebounceTime;       // Last debounce time
+  uint16_t pressStartTime;         // Press start time
+  uint16_t lastClickTime;          // Last click time
+  uint16_t generation;             // Incremented when the slot is freed, checked by PinHandle
+  uint32_t edgeTimeUs;             // First raw edge after the pin was last stable (micros() time base)
+};
+
+// Rate limiting state of a throttled pin (see ThrottlePolicy)
+struct PinThrottle {
+  uint8_t policy;                  // ThrottlePolicy (THROTTLE_NONE: free entry)
+  uint8_t maxEvents;               // Events let through per window
+  uint8_t windowEvents;            // Events let through in the current window
+  uint8_t pending : 1;             // Whether transitions are held back for a coalesced event
+  uint8_t heldState : 1;           // Level the consumers last saw before the held-back transitions
+  uint16_t windowMs;               // Window length
+  unsigned long windowStart;       // Start of the current window (ms)
+  unsigned long lastEdge;          // Last held-back transition (ms)
+  unsigned long suppressed;        // Transitions that did not get their own event
+};
+
+// Stable reference to a pin returned by addPin(). It stays valid until the pin
+// is removed, and resolving it is a bounds and generation check instead of a search.
+class PinHandle {
+public:
+  PinHandle() : value(0) {}
+  explicit PinHandle(uint32_t value) : value(value) {}
+  explicit operator bool() const { return value != 0; }
+  bool operator==(const PinHandle& other) const { return value == other.value; }
+  bool operator!=(const PinHandle& other) const { return value != other.value; }
+  
+private:
+  friend class AvantDigitalRead;
+  uint32_t value;  // Generation in the upper 16 bits, slot index + 1 in the lower 16 (0 = invalid)
+};
+
+// A pin read by the sampling timer
+struct TimerPin {
+  int pin;            // Pin number read by the timer (fixed while timer sampling runs)
+  PinHandle handle;   // Pin the samples are processed for (invalid once the pin is removed)
+};
+
+// Identifies a subscription made with subscribe() (0 = none)
+typedef uint32_t SubscriptionToken;
+
+// Kinds of pin table changes that can be deferred to the next pass
+enum PinChangeType {
+  PIN_CHANGE_ADD,
+  PIN_CHANGE_REMOVE,
+  PIN_CHANGE_SET_HANDLER,
+  PIN_CHANGE_SUBSCRIBE,
+  PIN_CHANGE_UNSUBSCRIBE,
+  PIN_CHANGE_RESERVE,
+  PIN_CHANGE_TIMING,
+  PIN_CHANGE_EVENTS,
+  PIN_CHANGE_SET_PROFILE,
+  PIN_CHANGE_ADD_PROFILE,
+  PIN_CHANGE_REMOVE_PROFILE,
+  PIN_CHANGE_PROFILE_TIMING,
+  PIN_CHANGE_THROTTLE,
+  PIN_CHANGE_REPLACE_PENDING,
+  PIN_CHANGE_SPECULATIVE,
+  PIN_CHANGE_ADD_ENCODER,
+  PIN_CHANGE_REMOVE_ENCODER,
+  PIN_CHANGE_COUNTER
+};
+
+// GestureProfile fields set by a timing change
+enum TimingField {
+  TIMING_DEBOUNCE = 1,     // debounceTime
+  TIMING_CLICK = 2,        // minPressMs, maxPressMs
+  TIMING_INTERVAL = 4,     // maxIntervalMs
+  TIMING_LONG_PRESS = 8    // pressDurationMs, repeatLongPress
+};
+
+// Pin table change requested while a pass was running or from another task
+struct PendingPinChange {
+  PinChangeType type;
+  PinHandle handle;         // Target pin (predicted handle for PIN_CHANGE_ADD)
+  int pin;                  // PIN_CHANGE_ADD
+  int mode;                 // PIN_CHANGE_ADD
+  EventType event;          // PIN_CHANGE_SET_HANDLER, PIN_CHANGE_SUBSCRIBE
+  PinCallback callback;     // PIN_CHANGE_SET_HANDLER, PIN_CHANGE_SUBSCRIBE
+  unsigned long delayMs;    // PIN_CHANGE_SET_HANDLER, PIN_CHANGE_SUBSCRIBE, PIN_CHANGE_THROTTLE (window)
+  SubscriptionToken token;  // PIN_CHANGE_SUBSCRIBE, PIN_CHANGE_UNSUBSCRIBE
+  size_t count;             // PIN_CHANGE_RESERVE, PIN_CHANGE_THROTTLE (max events)
+  GestureProfile timing;    // PIN_CHANGE_TIMING, PIN_CHANGE_PROFILE_TIMING (name: target profile)
+  uint8_t fields;           // TimingField bits to copy from timing
+  bool enabled;             // PIN_CHANGE_EVENTS (invalid handle: all pins), PIN_CHANGE_REPLACE_PENDING, PIN_CHANGE_SPECULATIVE,
+                            // PIN_CHANGE_COUNTER (event: edges, delayMs: window, callback: report)
+  ThrottlePolicy policy;    // PIN_CHANGE_THROTTLE
+  PinHandle other;          // PIN_CHANGE_ADD_ENCODER (pin B; handle: pin A, count: steps per detent)
+};
+
+// Edge counter of a pin in pulse counter mode
+struct PulseCounter {
+  PinHandle handle;
+  PinCallback callback;            // Called with EVENT_PULSE_REPORT when a window ends (optional)
+  uint64_t total;                  // Edges counted
+  unsigned long windowStart;       // Start of the current rate window (ms, time base of the passes)
+  bool windowStarted;              // Whether a pass has set windowStart yet
+  unsigned long windowMs;          // Length of the rate window
+  uint32_t windowPulses;           // Edges in the current window
+  uint32_t spanStartUs;            // Period averaging: edge the current span starts at
+  uint32_t spanPeriods;            // Periods completed since spanStartUs
+  uint32_t lastPulseUs;            // Latest edge (first raw edge of the transition)
+  uint32_t periodUs;               // Between the last two edges (0: fewer than two)
+  float rate;                      // Edges per second in the last complete window
+  EventType edges;                 // EVENT_RISING, EVENT_FALLING or EVENT_CHANGE (both)
+};
+
+// Quadrature rotary encoder read from two pins of the pin table
+struct EncoderInfo {
+  PinHandle handleA;               // Pins A and B (their raw readings are decoded)
+  PinHandle handleB;
+  PinCallback callback;            // Called with EVENT_ENCODER once per detent
+  long position;                   // Detents moved, scaled by acceleration
+  unsigned long lastDetentTime;    // For acceleration
+  uint16_t accelerationMs;         // Detents closer than this move by more than 1 (0 = off)
+  uint8_t maxStep;                 // Position change of the fastest detents
+  uint8_t stepsPerDetent;          // Quadrature steps between two detents (1, 2 or 4)
+  uint8_t state;                   // Last A/B reading (A in bit 1)
+  uint8_t restState;               // A/B reading at a detent (4-step encoders): both pins at their pull level
+  int8_t steps;                    // Quadrature steps since the last detent
+  int8_t lastDirection;            // Direction of the last detent (1 or -1)
+};
+
+// Callback subscribed to one event type of a pin
+struct PinHandler {
+  PinCallback callback;
+  unsigned long delayMs;
+  SubscriptionToken token;  // 0 for the handler set by onChange(), onRising(), ...
+  EventType event;
+  bool replacePending;      // Restart the pending delayed call instead of adding one (retriggerTimer())
 };
 
 class AvantDigitalRead {
 private:
   std::vector<PinInfo> pinList;  // Vector storing all pin information
-  std::vector<DelayedCallback> delayedCallbacks;  // Vector storing delayed callback information
+  std::vector<std::vector<PinHandler> > pinHandlers;  // Handlers of each pin sorted by event, parallel to pinList
+  SubscriptionToken nextToken;             // Token of the next subscribe() call
+  
+  // Deferred pin table changes
+  std::vector<PendingPinChange> pendingChanges;  // Changes waiting for the next pass (guarded by changeLock)
+  std::atomic<bool> changesPending;        // Whether pendingChanges has entries (the only check on the hot path)
+  bool inPass;                             // Whether a pass over the pins (and its callbacks) is running
+  bool deferredReconfiguration;            // Defer every change (update() runs in another task)
+#if defined(ESP32)
+  SemaphoreHandle_t changeLock;
+#elif !defined(ARDUINO)
+  std::mutex changeLock;
+#endif
+  
+  // Debounced levels published once per pass for other tasks (seqlock), with the pins in the
+  // table, so other tasks answer readPin() and pinHandle() without reading pinList
+  uint32_t levelWords[PIN_SNAPSHOT_WORDS * 2];  // Levels by pin number (sampling side)
+  bool levelsChanged;                      // Whether levelWords differs from publishedLevels
+  std::atomic<uint32_t> publishedLevels[PIN_SNAPSHOT_WORDS * 2];  // Copy read by readAll()
+  std::atomic<uint32_t> publishedPins[PIN_SNAPSHOT_WORDS * 2];    // Initialized pins by pin number
+  std::atomic<uint32_t> publishedSlots[MAX_PIN_SLOTS];  // Per slot: generation << 16 | in use << 8 | pin
+  std::atomic<uint32_t> publishedSlotCount;  // Slots published so far (the rest are empty)
+  std::atomic<uint32_t> snapshotSequence;  // Odd while the published words are being written
+  
+  std::vector<GestureProfile> profiles;    // Timing profiles referenced by PinInfo::profile (0 = defaults)
+  std::vector<PinThrottle> throttles;      // Rate limiting of the pins with a PinInfo::throttle
+  std::vector<EncoderInfo> encoders;       // Rotary encoders decoded after each reading of all pins
+  std::vector<PulseCounter> counters;      // Pins in pulse counter mode (searched on debounced edges only)
+  unsigned long timeEpoch;       // millis() value the PinInfo timestamps are relative to
+  std::vector<DelayedCallback> delayedCallbacks;  // Slots of delayed callbacks (freed slots are reused)
+  std::vector<uint16_t> freeDelayedSlots;  // Indexes of the free slots in delayedCallbacks
+  size_t pendingDelayed;                   // Slots holding a call that has not run yet
+  std::vector<DueCallback> dueCallbacks;   // Min-heap of due times; entries of cancelled or moved calls are skipped
+  uint32_t nextDueSequence;                // Sequence of the next call pushed to dueCallbacks
+  uint32_t readingTimeUs;                  // Time of the reading being processed (micros() time base)
+  EventTiming callbackTiming;              // Timing of the event whose callback is running
+  
+  // Slow callback watchdog
+  unsigned long callbackBudgetUs;          // Longest acceptable callback run (0 = callbacks are not timed)
+  SlowCallbackHook slowCallbackHook;       // Called after a run over the budget
+  bool deferSlowCallbacks;                 // Demote callbacks that ran over the budget
+  std::vector<CallbackStats> callbackStats; // One entry per timed callback function
+  
+  // Sampling/dispatch pipeline
+  AvantEventQueue<QueuedEvent, AVANT_EVENT_QUEUE_SIZE> eventQueue;  // Events waiting for the dispatch stage
+  bool queueEvents;                        // Whether events go to eventQueue instead of running directly
+  std::atomic<unsigned long> droppedEvents; // Events lost because eventQueue was full
+  std::atomic<bool> pipelineRunning;       // Whether the pipeline tasks are running (the sampler stops when cleared)
+  std::atomic<bool> dispatchRunning;       // Cleared after the sampler stopped: the dispatcher drains the queue and stops
+  unsigned long samplePeriodMs;            // Period of the sampling task
+#if defined(ESP32)
+  std::atomic<TaskHandle_t> samplingTask;  // Cleared by each task as it exits
+  std::atomic<TaskHandle_t> dispatchTask;
+  static void samplingTaskEntry(void* arg);
+  static void dispatchTaskEntry(void* arg);
+#elif !defined(ARDUINO)
+  std::thread samplingThread;
+  std::thread dispatchThread;
+#endif
+  
+  // Timer sampling
+  AvantEventQueue<RawSample, AVANT_SAMPLE_BUFFER_SIZE> sampleBuffer;  // Samples waiting for update()
+  std::vector<TimerPin> timerPins;         // Pins read by the sampling timer, bit order of RawSample
+  std::atomic<bool> timerSampling;         // Whether timer sampling is active
+  std::atomic<unsigned long> overrunSamples; // Samples lost because sampleBuffer was full
+  uint32_t captureSequence;                // Next sample number (timer side)
+  uint32_t sampleIntervalUs;               // Time between two timer samples
+  unsigned long timerStartTime;            // millis() when timer sampling began
+  uint32_t timerStartUs;                   // micros() at the same moment (time base of EventTiming)
+  uint32_t expectedSequence;               // Next sample number (update() side)
+  uint64_t timerElapsedUs;                 // Time of the next sample since timerStartTime
+#if defined(ESP32)
+  esp_timer_handle_t sampleTimer;
+  static void sampleTimerEntry(void* arg);
+#elif !defined(ARDUINO)
+  std::thread sampleTimerThread;
+#endif
+  
+  // Bulk sample ingestion
+  uint64_t sampleClockUs;                  // Time of the next bulk sample
+  bool sampleClockStarted;                 // Whether sampleClockUs has been anchored
+  uint32_t lastSampleWord;                 // Last word processed by processSamples()
+  unsigned long lastSampleTime;            // Millisecond of the last processed bulk sample
+  
+  // Diagnostics, allocated by the library build so the class layout does not depend on its options
+  AvantTraceBuffer* traceBuffer;           // Trace ring buffer (nullptr unless AVANT_TRACE_LEVEL > 0)
+  AvantLatencyTable* latencyTable;         // Latency histograms (nullptr unless AVANT_LATENCY_STATS)
+  
+  // Append a trace record
+  void trace(TraceId id, int pin, EventType event, uint32_t eventTimeUs, uint32_t value);
   
   // Find pin information
   PinInfo* findPin(int pin);
   
+  // Find pin information from a handle without searching (nullptr if stale)
+  PinInfo* resolvePin(PinHandle handle);
+  
+  // Handle of a pin from pinList (invalid for nullptr)
+  PinHandle handleOf(const PinInfo* pinInfo);
+  
+  // Handlers of a pin from pinList, in event order then subscription order
+  std::vector<PinHandler>& handlersOf(const PinInfo* pinInfo);
+  
+  // Add a handler after the existing handlers of its event
+  void addHandler(PinInfo* pinInfo, const PinHandler& handler);
+  
+  // Remove a handler and update PinInfo::subscribed
+  void removeHandler(PinInfo* pinInfo, size_t index);
+  
+  // Replace the onChange()/onRising()/... handler of an event (callback nullptr removes it)
+  void setHandler(PinInfo* pinInfo, EventType event, PinCallback callback, unsigned long delayMs);
+  
+  // setHandler() now, or at the next pass if changes are deferred
+  bool changeHandler(PinHandle handle, EventType event, PinCallback callback, unsigned long delayMs);
+  
+  // Set timing fields of a pin now, or at the next pass if changes are deferred
+  bool changeTiming(PinHandle handle, const GestureProfile& values, uint8_t fields);
+  
+  // Change the timing of a named profile now, or at the next pass if changes are deferred
+  bool changeProfileTiming(const char* name, const GestureProfile& values, uint8_t fields);
+  
+  // Enable or disable the events of a pin (invalid handle: all pins)
+  void setEventsEnabled(PinHandle handle, bool enabled);
+  
+  // Queue a change that names a profile
+  bool queueProfileChange(PinChangeType type, PinHandle handle, const char* name);
+  
+  // Add a named profile with the default timing (changes not deferred)
+  bool createProfile(const char* name);
+  
+  // Whether update() or the pipeline may run in another task than the caller
+  bool otherTasksActive();
+  
+  // Whether pin table changes must wait for the next pass
+  bool deferChanges();
+  
+  // Guard pendingChanges against the other task
+  void lockChanges();
+  bool tryLockChanges();
+  void unlockChanges();
+  
+  // Queue a change for the next pass
+  void queueChange(const PendingPinChange& change);
+  
+  // Apply the queued changes (called before each pass; wait false: skip them if they are being queued)
+  void applyPendingChanges(bool wait = true);
+  
+  // Slot a new pin will get, counting the adds still queued (changeLock held)
+  size_t predictSlot();
+  
+  // Handle a pin will have once the queued changes are applied (changeLock held)
+  PinHandle pendingHandle(int pin);
+  
+  // Published slot word of a pin table slot, and the handle of a pin from the snapshot
+  uint32_t slotWord(size_t slot);
+  PinHandle publishedHandle(int pin);
+  
+  // Add a pin in a given slot
+  PinHandle addPinToSlot(int pin, int mode, size_t slot);
+  
+  // Take a pin out of the table
+  void freePin(PinInfo* pinInfo);
+  
+  // Remove a subscribe() handler
+  bool removeSubscription(SubscriptionToken token);
+  
+  // Grow the pin table so AVANT_PIN_HEADROOM more pins fit without moving it
+  void reservePinHeadroom();
+  
+  // Give a pin a throttle policy (THROTTLE_NONE frees its PinThrottle)
+  bool applyThrottle(PinInfo* pinInfo, ThrottlePolicy policy, unsigned long windowMs, size_t maxEvents);
+  
+  // Whether a transition of a throttled pin gets its edge events now
+  bool admitEdge(PinInfo& pinInfo, PinState previousState, unsigned long currentTime);
+  
+  // Emit the coalesced event of a throttled pin once its window is over
+  void flushThrottle(PinInfo& pinInfo, unsigned long currentTime);
+  
+  // Record the debounced level of a pin for the next snapshot
+  void setLevel(const PinInfo* pinInfo, bool high);
+  
+  // Publish levelWords to other tasks if it changed
+  void publishLevels();
+  
+  // Publish the levels, and the slot of a pin added to or taken out of the table (changedPin)
+  void publishSnapshot(const PinInfo* changedPin);
+  
+  // Emit the events in eventMask that the pin has handlers for
+  void emitPinEvents(PinInfo* pinInfo, uint8_t eventMask, PinState newState,
+                     PinState oldState, unsigned long timestamp);
+  
+  // Find a named profile, returns -1 if there is none
+  int findProfile(const char* name);
+  
+  // Store values in a free profile slot, returns -1 if all slots are used
+  int allocateProfile(const GestureProfile& values);
+  
+  // Index of an unnamed profile holding these values, created if needed (-1 if full)
+  int internProfile(const GestureProfile& values);
+  
+  // Point a pin at another profile
+  void assignProfile(PinInfo* pinInfo, int profile);
+  
+  // Give a pin its own timing (shared with pins having the same values)
+  bool setPinTiming(PinInfo* pinInfo, const GestureProfile& values);
+  
+  // Move timeEpoch forward before pins are processed at currentTime
+  void advanceEpoch(unsigned long currentTime);
+  
   // Trigger callback function
   void triggerCallback(PinCallback callback, int pin, PinState newState, 
                       PinState oldState, EventType event, 
-                      unsigned long timestamp, unsigned long delayMs);
+                      unsigned long timestamp, unsigned long delayMs,
+                      bool replacePending, const EventTiming& timing);
+  
+  // Emit an event, directly or through the event queue
+  void emitEvent(PinCallback callback, int pin, PinState newState,
+                 PinState oldState, EventType event,
+                 unsigned long timestamp, unsigned long delayMs,
+                 bool replacePending, const EventTiming& timing);
+  
+  // Store a delayed call in a free slot
+  CallbackHandle scheduleDelayed(const DelayedCallback& delayedCb);
+  
+  // Free the slot of a delayed call
+  void releaseDelayed(size_t slot);
+  
+  // Add the current due time of a slot to dueCallbacks
+  void pushDue(size_t slot);
+  
+  // Subscribe a handler (replacePending: retriggerable timer)
+  SubscriptionToken addSubscription(PinHandle handle, EventType event, PinCallback callback,
+                                    unsigned long delayMs, bool replacePending);
+  
+  // Drop the delayed calls of a pin (timers: also its startTimer() timers), or hand that to the dispatch stage
+  void dropPendingCallbacks(int pin, bool timers);
+  
+  // Cancel the pending delayed calls of a pin (timers: also its startTimer() timers)
+  size_t cancelPending(int pin, bool timers);
+  
+  // Run a callback (the one place callbacks are called, timed with AVANT_LATENCY_STATS)
+  void runCallback(PinCallback callback, int pin, PinState newState, PinState oldState,
+                   EventType event, unsigned long timestamp, const EventTiming& timing);
+  
+  // Record the run time of a callback while a budget is set
+  void recordCallbackTime(PinCallback callback, int pin, EventType event, uint32_t durationUs);
+  
+  // Whether a callback was demoted to run after the pass
+  bool isDeferredCallback(PinCallback callback);
   
   // Process delayed callbacks
   void processDelayedCallbacks(unsigned long currentTime);
   
+  // Read, debounce and detect gestures on all pins
+  void samplePins(unsigned long currentTime);
+  
+  // Debounce one raw reading of a pin and emit edge events
+  void processReading(PinInfo& pinInfo, int rawReading, unsigned long currentTime);
+  
+  // Feed the samples accumulated by the sampling timer through processReading()
+  void processTimerSamples();
+  
   // Detect button gestures
   void detectButtonGestures(PinInfo* pinInfo, unsigned long currentTime);
   
+  // Decode the rotary encoders whose pins were just read (timerPass: timer-sampled pins)
+  void decodeEncoders(unsigned long currentTime, bool timerPass);
+  
+  // Add an encoder on two pins already in the table
+  void addEncoderToTable(PinHandle handleA, PinHandle handleB, PinCallback callback, uint8_t stepsPerDetent, int mode);
+  
+  // Remove an encoder and its two pins
+  void removeEncoderFromTable(PinHandle handleA);
+  
+  // Find the encoder whose pin A is pin
+  EncoderInfo* findEncoder(int pinA);
+  
+  // Count a debounced edge of a pin in pulse counter mode
+  void countPulse(PinInfo& pinInfo, PinState newState);
+  
+  // End the rate windows that are over (timerPass: counters of timer-sampled pins)
+  void updateCounters(unsigned long currentTime, bool timerPass);
+  
+  // Start (enabled) or stop counting the edges of a pin
+  void applyCounter(PinInfo* pinInfo, bool enabled, EventType edges, unsigned long windowMs, PinCallback callback);
+  
+  // Find the pulse counter of a pin
+  PulseCounter* findCounter(int pin);
+  
+  // Set the clicks of the pending gesture of a pin (traced at TRACE_LEVEL_PINS)
+  void setClickCount(PinInfo* pinInfo, uint8_t clickCount);
+  
 public:
   AvantDigitalRead();
   ~AvantDigitalRead();
   
-  // Pin management functions
-  bool addPin(int pin, int mode);
+  // Pin management functions. The getters (isInitialized, getPinMode, getDebounceTime,
+  // getPinProfile, getSuppressedEvents, ...) read the pin table unsynchronized: call them from
+  // a callback or the task that runs update() or sample(). readPin(), readAll() and pinHandle()
+  // can be called from any task: from other tasks they read the published snapshot.
+  PinHandle addPin(int pin, int mode);  // Invalid handle (false) on failure
   bool removePin(int pin);
+  bool removePin(PinHandle handle);
   bool isInitialized(int pin);
+  bool isInitialized(PinHandle handle);
   int getPinMode(int pin);
+  int getPinMode(PinHandle handle);
   PinState readPin(int pin);
+  PinState readPin(PinHandle handle);
+  PinHandle pinHandle(int pin);  // Handle of an initialized pin (invalid if there is none)
+  uint32_t readAll(uint64_t* mask);  // Levels of all pins (PIN_SNAPSHOT_WORDS words), returns the snapshot number
+  const EventTiming& getEventTiming();  // Edge and acceptance time of the event of the running callback
   
-  // Debounce setting functions
+  // Debounce setting functions. Timing values (debounce, click, double press, long press and
+  // throttle window) are limited to MAX_PIN_TIMING_MS (32767 ms): larger values return false.
   bool setDebounceTime(int pin, unsigned long debounceMs);
+  bool setDebounceTime(PinHandle handle, unsigned long debounceMs);
   unsigned long getDebounceTime(int pin);
+  unsigned long getDebounceTime(PinHandle handle);
   
   // Event callback management functions
   bool onChange(int pin, PinCallback callback, unsigned long delayMs = 0);
+  bool onChange(PinHandle handle, PinCallback callback, unsigned long delayMs = 0);
   bool onRising(int pin, PinCallback callback, unsigned long delayMs = 0);
+  bool onRising(PinHandle handle, PinCallback callback, unsigned long delayMs = 0);
   bool onFalling(int pin, PinCallback callback, unsigned long delayMs = 0);
+  bool onFalling(PinHandle handle, PinCallback callback, unsigned long delayMs = 0);
   
   // Button gesture detection functions
   bool onSinglePress(int pin, PinCallback callback, unsigned long delayMs = 0);
+  bool onSinglePress(PinHandle handle, PinCallback callback, unsigned long delayMs = 0);
   bool setClickParameters(int pin, unsigned long minPressMs = DEFAULT_MIN_PRESS_MS, unsigned long maxPressMs = DEFAULT_MAX_PRESS_MS);
+  bool setClickParameters(PinHandle handle, unsigned long minPressMs = DEFAULT_MIN_PRESS_MS, unsigned long maxPressMs = DEFAULT_MAX_PRESS_MS);
   bool onDoublePress(int pin, PinCallback callback, unsigned long delayMs = 0, unsigned long maxIntervalMs = DEFAULT_MAX_INTERVAL_MS);
+  bool onDoublePress(PinHandle handle, PinCallback callback, unsigned long delayMs = 0, unsigned long maxIntervalMs = DEFAULT_MAX_INTERVAL_MS);
   bool onLongPress(int pin, PinCallback callback, unsigned long delayMs = 0, unsigned long pressDurationMs = DEFAULT_PRESS_DURATION_MS, bool repeat = DEFAULT_REPEAT_LONG_PRESS);
+  bool onLongPress(PinHandle handle, PinCallback callback, unsigned long delayMs = 0, unsigned long pressDurationMs = DEFAULT_PRESS_DURATION_MS, bool repeat = DEFAULT_REPEAT_LONG_PRESS);
+  bool setSpeculativeSinglePress(int pin, bool enabled = true);  // Single press at once, EVENT_SINGLE_PRESS_RETRACT if it becomes a double press
+  bool setSpeculativeSinglePress(PinHandle handle, bool enabled = true);
+  
+  // Gesture profile functions (timing shared by a group of pins)
+  bool addProfile(const char* name);
+  bool removeProfile(const char* name);
+  bool setPinProfile(int pin, const char* name);
+  bool setPinProfile(PinHandle handle, const char* name);
+  bool getPinProfile(int pin, char* name, size_t size);  // Copies the name (false: own timing)
+  bool getPinProfile(PinHandle handle, char* name, size_t size);
+  bool setProfileDebounceTime(const char* name, unsigned long debounceMs);
+  bool setProfileClickParameters(const char* name, unsigned long minPressMs = DEFAULT_MIN_PRESS_MS, unsigned long maxPressMs = DEFAULT_MAX_PRESS_MS);
+  bool setProfileDoublePressInterval(const char* name, unsigned long maxIntervalMs = DEFAULT_MAX_INTERVAL_MS);
+  bool setProfileLongPress(const char* name, unsigned long pressDurationMs = DEFAULT_PRESS_DURATION_MS, bool repeat = DEFAULT_REPEAT_LONG_PRESS);
+  
+  // Multiple subscribers per pin event (onChange() and friends keep one replaceable handler each)
+  SubscriptionToken subscribe(int pin, EventType event, PinCallback callback, unsigned long delayMs = 0);
+  SubscriptionToken subscribe(PinHandle handle, EventType event, PinCallback callback, unsigned long delayMs = 0);
+  bool unsubscribe(SubscriptionToken token);
+  bool reserveSubscribers(int pin, size_t count);
+  bool reserveSubscribers(PinHandle handle, size_t count);
+  
+  // Reconfiguration from callbacks and other tasks
+  void setDeferredReconfiguration(bool enabled);  // Always queue pin changes for the next pass (required when update() runs in another task than the changes)
+  size_t getPendingChanges();
+  
+  // Rate limiting of edge events (change, rising, falling) for bursty inputs
+  bool setThrottle(int pin, ThrottlePolicy policy, unsigned long windowMs, uint8_t maxEvents = 1);
+  bool setThrottle(PinHandle handle, ThrottlePolicy policy, unsigned long windowMs, uint8_t maxEvents = 1);
+  unsigned long getSuppressedEvents(int pin);
+  unsigned long getSuppressedEvents(PinHandle handle);
+  
+  // Delayed callbacks that only run for the last event of a burst (trailing debounce)
+  bool setReplacePending(int pin, bool enabled = true);
+  bool setReplacePending(PinHandle handle, bool enabled = true);
+  
+  // Pending delayed callbacks (from the task that runs update() or dispatch(), or a callback)
+  CallbackHandle getPendingCallback(int pin, EventType event);  // Latest pending call (0 if none)
+  bool cancel(CallbackHandle handle);
+  size_t cancelAll(int pin);
+  size_t getPendingCallbacks();
+  
+  // Software timers on the delayed callback scheduler (same threading rules as cancel())
+  CallbackHandle startTimer(int pin, PinCallback callback, unsigned long delayMs, unsigned long periodMs = 0);
+  bool restartTimer(CallbackHandle handle);  // Count the delay again from now
+  SubscriptionToken retriggerTimer(int pin, EventType trigger, PinCallback callback, unsigned long timeoutMs);
+  SubscriptionToken retriggerTimer(PinHandle handle, EventType trigger, PinCallback callback, unsigned long timeoutMs);
+  
+  // Quadrature rotary encoders (identified by pin A)
+  bool addEncoder(int pinA, int pinB, PinCallback callback,
+                  uint8_t stepsPerDetent = DEFAULT_ENCODER_STEPS_PER_DETENT, int mode = INPUT_PULLUP);
+  bool removeEncoder(int pinA);
+  long getEncoderPosition(int pinA);
+  bool setEncoderPosition(int pinA, long position);
+  bool setEncoderAcceleration(int pinA, unsigned long accelerationMs, uint8_t maxStep);
+  
+  // Pulse counting (edges counted without callbacks)
+  bool setPulseCounter(int pin, EventType edges = EVENT_RISING, unsigned long windowMs = DEFAULT_PULSE_WINDOW_MS,
+                       PinCallback reportCallback = nullptr);
+  bool setPulseCounter(PinHandle handle, EventType edges = EVENT_RISING, unsigned long windowMs = DEFAULT_PULSE_WINDOW_MS,
+                       PinCallback reportCallback = nullptr);
+  bool removePulseCounter(int pin);
+  uint64_t getPulseCount(int pin);
+  bool resetPulseCount(int pin);
+  float getPulseFrequency(int pin);  // Hz, from the average period of the current window
+  float getPulseRate(int pin);       // Edges per second in the last complete window
   
   // Event management functions
   bool enablePinEvents(int pin);
+  bool enablePinEvents(PinHandle handle);
   bool disablePinEvents(int pin);
+  bool disablePinEvents(PinHandle handle);
   void enableAllEvents();
   void disableAllEvents();
   
   // Core processing function
   void update();
+  
+  // Pipeline stages (see startPipeline)
+  void sample();    // Sampling stage: read pins, debounce, detect gestures and queue events
+  void dispatch();  // Dispatch stage: run queued and due delayed callbacks
+  
+  // Pipeline task management
+  bool startPipeline(unsigned long samplePeriodMs = DEFAULT_SAMPLE_PERIOD_MS,
+                     int samplingCore = DEFAULT_SAMPLING_CORE,
+                     int dispatchCore = DEFAULT_DISPATCH_CORE);
+  void stopPipeline();
+  bool isPipelineRunning();
+  unsigned long getDroppedEvents();
+  size_t getQueuedEvents();
+  
+  // Fixed-rate timer sampling
+  bool beginTimerSampling(unsigned long sampleRateHz = DEFAULT_SAMPLE_RATE_HZ, bool internalTimer = true);
+  void endTimerSampling();
+  bool isTimerSampling();
+  void captureSample();  // Take one sample now (called by the timer, or by your own timer interrupt)
+  unsigned long getOverrunSamples();
+  
+  // Bulk sample ingestion (bit n of each word is the level of pin n)
+  bool processSamples(const uint32_t* words, size_t count, uint32_t sampleIntervalUs);
+  void processSample(uint32_t word, unsigned long timeMs);  // One snapshot at an explicit time
+  void setSampleClock(unsigned long timeMs);
+  
+  // Slow callback watchdog (budget 0 turns it off)
+  void setCallbackBudget(unsigned long budgetUs, SlowCallbackHook hook = nullptr, bool deferSlow = false);
+  unsigned long getCallbackBudget();
+  size_t getCallbackStatsCount();
+  bool getCallbackStats(size_t index, CallbackStats* stats);
+  void resetCallbackStats();  // Also restores demoted callbacks
+  
+  // Trace buffer (empty unless built with AVANT_TRACE_LEVEL > 0); read records are removed
+  size_t readTrace(TraceRecord* records, size_t maxRecords);
+  size_t printTrace(Print& out);  // Format the records, returns how many were printed
+  void clearTrace();
+  unsigned long getLostTraceRecords();  // Records overwritten before they were read
+  
+  // Callback latency instrumentation (false unless built with AVANT_LATENCY_STATS)
+  bool enableLatencyStats(int pin);
+  bool getLatencyStats(int pin, EventType event, LatencyHistogram* histogram);
+  void resetLatencyStats();
 };
 
 #endif // AVANTDIGITALREAD_H
\ No newline at end of file
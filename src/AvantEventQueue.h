@@ -0,0 +1,55 @@
+#ifndef AVANTEVENTQUEUE_H
+#define AVANTEVENTQUEUE_H
+
+#include <stddef.h>
+#include <atomic>
+
+// Lock-free single-producer/single-consumer ring buffer.
+// Exactly one task may call push() and exactly one task may call pop().
+// Capacity must be a power of two; one slot is never used.
+template <typename T, size_t Capacity>
+class AvantEventQueue {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "AvantEventQueue capacity must be a power of two");
+
+public:
+  AvantEventQueue() : head(0), tail(0) {}
+
+  // Add an item (producer side), returns false when the queue is full
+  bool push(const T& item) {
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    size_t nextTail = (currentTail + 1) & (Capacity - 1);
+    if (nextTail == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    buffer[currentTail] = item;
+    tail.store(nextTail, std::memory_order_release);
+    return true;
+  }
+
+  // Remove an item (consumer side), returns false when the queue is empty
+  bool pop(T& item) {
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead == tail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = buffer[currentHead];
+    head.store((currentHead + 1) & (Capacity - 1), std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+  }
+
+  size_t size() const {
+    return (tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire)) & (Capacity - 1);
+  }
+
+private:
+  T buffer[Capacity];
+  std::atomic<size_t> head;  // Next slot to read (owned by consumer)
+  std::atomic<size_t> tail;  // Next slot to write (owned by producer)
+};
+
+#endif // AVANTEVENTQUEUE_H